@@ -0,0 +1,33 @@
+# Writes a C++ source holding each file in FILES (paths relative to ROOT) as a
+# constexpr byte array, plus the embeddedAssets table that indexes them by path.
+#
+# cmake -DROOT=<dir> -DOUTPUT=<file.cpp> -DFILES="shader/a.glsl;texture/b.png" -P embed_assets.cmake
+
+set(declarations "")
+set(table "")
+set(index 0)
+# CMake regexes have no {n} repetition
+set(line "")
+foreach(i RANGE 1 32)
+    string(APPEND line "0x..,")
+endforeach()
+foreach(file ${FILES})
+    file(READ ${ROOT}/${file} hex HEX)
+    string(REGEX REPLACE "([0-9a-f][0-9a-f])" "0x\\1," bytes "${hex}")
+    # Wrap every 32 bytes so the generated file stays readable by editors and compilers
+    string(REGEX REPLACE "(${line})" "\\1\n    " bytes "${bytes}")
+    # The trailing zero keeps empty files valid and null-terminates text
+    string(APPEND declarations "constexpr unsigned char asset${index}[] = {\n    ${bytes}0x00};\n\n")
+    string(APPEND table "    {\"${file}\", asset${index}, sizeof(asset${index}) - 1},\n")
+    math(EXPR index "${index} + 1")
+endforeach()
+
+file(WRITE ${OUTPUT}.tmp
+    "// Generated by cmake/embed_assets.cmake, do not edit\n"
+    "#include \"embeddedassets.hpp\"\n\n"
+    "namespace\n{\n${declarations}}\n\n"
+    "const EmbeddedAsset embeddedAssets[] = {\n${table}};\n"
+    "const size_t embeddedAssetCount = ${index};\n")
+# Only touch the output when it changed, so unrelated edits don't recompile it
+execute_process(COMMAND ${CMAKE_COMMAND} -E copy_if_different ${OUTPUT}.tmp ${OUTPUT})
+file(REMOVE ${OUTPUT}.tmp)
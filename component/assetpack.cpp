@@ -0,0 +1,371 @@
+#include "assetpack.hpp"
+
+#include <stdio.h>
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+    const uint32_t packVersion = 1;
+    const size_t blobAlignment = 16;
+
+    const EmbeddedAsset *embedded = nullptr;
+    size_t embeddedCount = 0;
+    bool looseFirst = false;
+
+    /**
+     * @brief Looks a name up in the embedded assets, then in the pack.
+     */
+    bool findBuiltIn(const std::string &name, const unsigned char *&bytes, size_t &size)
+    {
+        for (size_t i = 0; i < embeddedCount; i++)
+        {
+            if (name == embedded[i].name)
+            {
+                bytes = embedded[i].data;
+                size = embedded[i].size;
+                return true;
+            }
+        }
+        return AssetPack::instance().find(name, bytes, size);
+    }
+
+    /**
+     * @brief Maps a whole file read-only. Returns false if it can't be opened or mapped.
+     */
+    bool mapFile(const std::string &path, void *&mapping, size_t &length)
+    {
+#ifndef _WIN32
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0)
+            return false;
+        struct stat info;
+        bool ok = fstat(fd, &info) == 0 && info.st_size > 0;
+        if (ok)
+        {
+            mapping = mmap(NULL, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            length = info.st_size;
+            ok = mapping != MAP_FAILED;
+            if (!ok)
+                mapping = nullptr;
+        }
+        ::close(fd);
+        return ok;
+#else
+        return false;
+#endif
+    }
+
+    void unmapFile(void *mapping, size_t length)
+    {
+#ifndef _WIN32
+        if (mapping)
+            munmap(mapping, length);
+#endif
+    }
+
+    bool readFile(const std::string &path, std::vector<unsigned char> &buffer)
+    {
+        FILE *file = fopen(path.c_str(), "rb");
+        if (!file)
+            return false;
+        fseek(file, 0, SEEK_END);
+        buffer.resize(ftell(file));
+        fseek(file, 0, SEEK_SET);
+        size_t read = fread(buffer.data(), 1, buffer.size(), file);
+        fclose(file);
+        return read == buffer.size();
+    }
+}
+
+Asset::Asset(Asset &&other) noexcept
+    : bytes(other.bytes), length(other.length), mapping(other.mapping), mappingLength(other.mappingLength),
+      buffer(std::move(other.buffer))
+{
+    other.bytes = nullptr;
+    other.length = 0;
+    other.mapping = nullptr;
+}
+
+Asset &Asset::operator=(Asset &&other) noexcept
+{
+    if (this != &other)
+    {
+        release();
+        bytes = other.bytes;
+        length = other.length;
+        mapping = other.mapping;
+        mappingLength = other.mappingLength;
+        buffer = std::move(other.buffer);
+        other.bytes = nullptr;
+        other.length = 0;
+        other.mapping = nullptr;
+    }
+    return *this;
+}
+
+Asset::~Asset()
+{
+    release();
+}
+
+void Asset::release()
+{
+    unmapFile(mapping, mappingLength);
+    mapping = nullptr;
+    buffer.clear();
+    bytes = nullptr;
+    length = 0;
+}
+
+/**
+ * @brief Pack name for an asset path: lexically normalized, leading ./ and ../ removed,
+ * forward slashes. "../shader/particle_v.glsl" -> "shader/particle_v.glsl".
+ */
+std::string assetName(const std::string &path)
+{
+    std::string name = std::filesystem::path(path).lexically_normal().generic_string();
+    while (name.compare(0, 2, "./") == 0 || name.compare(0, 3, "../") == 0)
+    {
+        name.erase(0, name[1] == '/' ? 2 : 3);
+    }
+    return name;
+}
+
+/**
+ * @brief Registers the assets compiled into the executable. They take precedence over the pack.
+ */
+void setEmbeddedAssets(const EmbeddedAsset *assets, size_t count)
+{
+    embedded = assets;
+    embeddedCount = count;
+}
+
+/**
+ * @brief When set, loose files override embedded and packed assets, so edits on disk are seen.
+ */
+void setLooseAssetsFirst(bool enabled)
+{
+    looseFirst = enabled;
+}
+
+/**
+ * @brief True if readAsset() will serve the path from memory without touching the filesystem.
+ */
+bool assetBuiltIn(const std::string &path)
+{
+    const unsigned char *bytes;
+    size_t size;
+    return !looseFirst && findBuiltIn(assetName(path), bytes, size);
+}
+
+/**
+ * @brief Reads an asset from the embedded assets, the open pack or the loose file, in that order.
+ *
+ * @param path Asset path as it would be opened from the working directory.
+ * @param asset Receives a view of the bytes; valid while asset lives.
+ * @return false if the asset exists nowhere.
+ */
+bool readAsset(const std::string &path, Asset &asset)
+{
+    asset.release();
+    const unsigned char *bytes;
+    size_t size;
+    if (!looseFirst && findBuiltIn(assetName(path), bytes, size))
+    {
+        asset.bytes = bytes;
+        asset.length = size;
+        return true;
+    }
+
+    if (mapFile(path, asset.mapping, asset.mappingLength))
+    {
+        asset.bytes = (const unsigned char *)asset.mapping;
+        asset.length = asset.mappingLength;
+        return true;
+    }
+    // Empty files can't be mapped; unmappable filesystems fall back to a copy
+    if (readFile(path, asset.buffer))
+    {
+        asset.bytes = asset.buffer.data();
+        asset.length = asset.buffer.size();
+        return true;
+    }
+
+    if (looseFirst && findBuiltIn(assetName(path), bytes, size))
+    {
+        asset.bytes = bytes;
+        asset.length = size;
+        return true;
+    }
+    return false;
+}
+
+AssetPack &AssetPack::instance()
+{
+    static AssetPack pack;
+    return pack;
+}
+
+AssetPack::~AssetPack()
+{
+    if (buffer.empty())
+        unmapFile((void *)data, size);
+}
+
+/**
+ * @brief Maps a pack built by the assetpack tool and validates its index.
+ */
+bool AssetPack::open(const std::string &path)
+{
+    void *mapping = nullptr;
+    size_t length = 0;
+    if (mapFile(path, mapping, length))
+    {
+        data = (const unsigned char *)mapping;
+        size = length;
+    }
+    else if (readFile(path, buffer))
+    {
+        data = buffer.data();
+        size = buffer.size();
+    }
+    else
+    {
+        return false;
+    }
+
+    const AssetPackHeader *header = (const AssetPackHeader *)data;
+    bool valid = size >= sizeof(AssetPackHeader) && memcmp(header->magic, "CPAK", 4) == 0 &&
+                 header->version == packVersion &&
+                 size >= sizeof(AssetPackHeader) + (size_t)header->count * sizeof(AssetPackEntry);
+    const AssetPackEntry *entries = (const AssetPackEntry *)(data + sizeof(AssetPackHeader));
+    for (uint32_t i = 0; valid && i < header->count; i++)
+    {
+        valid = entries[i].offset + entries[i].size <= size &&
+                (size_t)entries[i].nameOffset + entries[i].nameLength <= size;
+    }
+    if (!valid)
+    {
+        fprintf(stderr, "%s is not a valid asset pack, using loose files\n", path.c_str());
+        if (buffer.empty())
+            unmapFile(mapping, length);
+        buffer.clear();
+        data = nullptr;
+        size = 0;
+        return false;
+    }
+    printf("Asset pack %s: %u files\n", path.c_str(), header->count);
+    return true;
+}
+
+/**
+ * @brief Defers open() to the first find(), and tries it only once.
+ *
+ * Probing the disk for a pack costs a failed open at every start; with this,
+ * only a run that needs something beyond the embedded assets pays for it.
+ */
+void AssetPack::openOnFirstUse(const std::string &path)
+{
+    std::lock_guard<std::mutex> lock(deferredMutex);
+    deferredPath = path;
+}
+
+/**
+ * @brief Binary search of the index. Opens a deferred pack first.
+ */
+bool AssetPack::find(const std::string &name, const unsigned char *&bytes, size_t &length)
+{
+    {
+        // Asset reads also come from the texture workers
+        std::lock_guard<std::mutex> lock(deferredMutex);
+        if (!deferredPath.empty())
+        {
+            std::string path;
+            path.swap(deferredPath);
+            open(path);
+        }
+    }
+    if (!data)
+        return false;
+    const AssetPackHeader *header = (const AssetPackHeader *)data;
+    const AssetPackEntry *begin = (const AssetPackEntry *)(data + sizeof(AssetPackHeader));
+    const AssetPackEntry *end = begin + header->count;
+    auto nameOf = [this](const AssetPackEntry &entry) {
+        return std::string((const char *)data + entry.nameOffset, entry.nameLength);
+    };
+    const AssetPackEntry *entry = std::lower_bound(begin, end, name, [&nameOf](const AssetPackEntry &entry, const std::string &name) {
+        return nameOf(entry) < name;
+    });
+    if (entry == end || nameOf(*entry) != name)
+        return false;
+    bytes = data + entry->offset;
+    length = entry->size;
+    return true;
+}
+
+/**
+ * @brief Writes a pack holding the given files under the given names.
+ *
+ * @param names Pack names, normally assetName() of the path the program opens.
+ * @param files Files to read the contents from, parallel to names.
+ */
+bool assetPackWrite(const std::string &path, const std::vector<std::string> &names, const std::vector<std::string> &files)
+{
+    std::vector<size_t> order(names.size());
+    for (size_t i = 0; i < order.size(); i++)
+        order[i] = i;
+    std::sort(order.begin(), order.end(), [&names](size_t a, size_t b) { return names[a] < names[b]; });
+
+    AssetPackHeader header = {{'C', 'P', 'A', 'K'}, packVersion, (uint32_t)names.size(), 0};
+    std::vector<AssetPackEntry> entries(names.size());
+    std::vector<std::vector<unsigned char>> contents(names.size());
+
+    size_t offset = sizeof(AssetPackHeader) + sizeof(AssetPackEntry) * entries.size();
+    for (size_t i = 0; i < order.size(); i++)
+    {
+        entries[i].nameOffset = (uint32_t)offset;
+        entries[i].nameLength = (uint32_t)names[order[i]].size();
+        offset += names[order[i]].size();
+    }
+    for (size_t i = 0; i < order.size(); i++)
+    {
+        if (!readFile(files[order[i]], contents[i]))
+        {
+            fprintf(stderr, "Cannot read %s\n", files[order[i]].c_str());
+            return false;
+        }
+        offset = (offset + blobAlignment - 1) / blobAlignment * blobAlignment;
+        entries[i].offset = offset;
+        entries[i].size = contents[i].size();
+        offset += contents[i].size();
+    }
+
+    FILE *file = fopen(path.c_str(), "wb");
+    if (!file)
+    {
+        fprintf(stderr, "Cannot write %s\n", path.c_str());
+        return false;
+    }
+    fwrite(&header, sizeof(header), 1, file);
+    fwrite(entries.data(), sizeof(AssetPackEntry), entries.size(), file);
+    for (size_t i = 0; i < order.size(); i++)
+        fwrite(names[order[i]].data(), 1, names[order[i]].size(), file);
+    const unsigned char padding[blobAlignment] = {};
+    for (size_t i = 0; i < order.size(); i++)
+    {
+        fwrite(padding, 1, entries[i].offset - ftell(file), file);
+        fwrite(contents[i].data(), 1, contents[i].size(), file);
+    }
+    bool ok = ferror(file) == 0;
+    fclose(file);
+    return ok;
+}
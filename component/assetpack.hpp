@@ -0,0 +1,112 @@
+#ifndef ASSETPACK_HPP
+#define ASSETPACK_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Asset archive layout: a header, an index sorted by name, the name
+ * strings, then each file's bytes aligned to 16.
+ */
+struct AssetPackHeader
+{
+    char magic[4]; // "CPAK"
+    uint32_t version;
+    uint32_t count;
+    uint32_t reserved;
+};
+
+struct AssetPackEntry
+{
+    uint64_t offset; // From the start of the pack
+    uint64_t size;
+    uint32_t nameOffset; // From the start of the pack
+    uint32_t nameLength;
+};
+
+/**
+ * @brief A file compiled into the executable, see cmake/embed_assets.cmake.
+ */
+struct EmbeddedAsset
+{
+    const char *name; // assetName() of the source path
+    const unsigned char *data;
+    size_t size;
+};
+
+/**
+ * @brief Read-only bytes of one asset.
+ *
+ * Points into the embedded data, the mapped pack or a mapping of the loose
+ * file, so reading an asset never copies it; a heap copy is only made where
+ * mapping is unavailable.
+ */
+class Asset
+{
+public:
+    Asset() : bytes(nullptr), length(0), mapping(nullptr), mappingLength(0) {}
+    Asset(Asset &&other) noexcept;
+    Asset &operator=(Asset &&other) noexcept;
+    ~Asset();
+
+    Asset(const Asset &) = delete;
+    Asset &operator=(const Asset &) = delete;
+
+    const unsigned char *data() const { return bytes; }
+    size_t size() const { return length; }
+    std::string text() const { return std::string((const char *)bytes, length); }
+
+private:
+    friend bool readAsset(const std::string &path, Asset &asset);
+    void release();
+
+    const unsigned char *bytes;
+    size_t length;
+    void *mapping;
+    size_t mappingLength;
+    std::vector<unsigned char> buffer;
+};
+
+std::string assetName(const std::string &path);
+bool readAsset(const std::string &path, Asset &asset);
+bool assetBuiltIn(const std::string &path);
+void setEmbeddedAssets(const EmbeddedAsset *assets, size_t count);
+void setLooseAssetsFirst(bool enabled);
+
+/**
+ * @brief The process-wide asset archive.
+ *
+ * Asset paths keep their on-disk spelling (e.g. "../shader/particle_v.glsl")
+ * and are looked up by assetName(), which drops the leading ./ and ../
+ * components. readAsset() tries the assets embedded in the executable, then
+ * the pack, then the loose file; setLooseAssetsFirst() moves loose files to
+ * the front for development. openOnFirstUse() leaves the pack closed until a
+ * lookup gets past the embedded assets, so a run they cover never looks for it.
+ */
+class AssetPack
+{
+public:
+    static AssetPack &instance();
+
+    bool open(const std::string &path);
+    void openOnFirstUse(const std::string &path);
+    bool isOpen() const { return data != nullptr; }
+    bool find(const std::string &name, const unsigned char *&bytes, size_t &size);
+
+private:
+    AssetPack() : data(nullptr), size(0) {}
+    ~AssetPack();
+
+    const unsigned char *data;
+    size_t size;
+    std::vector<unsigned char> buffer;
+    std::mutex deferredMutex;
+    std::string deferredPath; // Opened by the next find(), then cleared
+};
+
+bool assetPackWrite(const std::string &path, const std::vector<std::string> &names, const std::vector<std::string> &files);
+
+#endif
@@ -0,0 +1,295 @@
+#include "asynctexture.hpp"
+#include "threadpool.hpp"
+#include "profiler.hpp"
+#include "texturedump.hpp"
+#include "assetpack.hpp"
+#include "stb_image.h"
+
+#include <stdio.h>
+#include <chrono>
+#include <cstring>
+
+AsyncTextureLoader::AsyncTextureLoader() : inFlight(0), pixelBuffers{0, 0, 0}, nextBuffer(0)
+{
+}
+
+AsyncTextureLoader::~AsyncTextureLoader()
+{
+    // GL objects are released in shutdown() while the context still exists;
+    // here we only make sure no decode job outlives the loader
+    std::unique_lock<std::mutex> lock(mutex);
+    decoded.wait(lock, [this] { return inFlight == 0; });
+    for (Image &image : ready)
+    {
+        stbi_image_free(image.pixels);
+    }
+}
+
+AsyncTextureLoader &AsyncTextureLoader::instance()
+{
+    static AsyncTextureLoader loader;
+    return loader;
+}
+
+/**
+ * @brief Creates a placeholder texture and starts decoding the file in the background.
+ *
+ * @param path Image file path.
+ * @param sampling Wrap and filter modes for the uploaded image.
+ * @return A texture name that is valid immediately and receives the image once pump() uploads it.
+ */
+GLuint AsyncTextureLoader::request(const std::string &path, const TextureSampling &sampling)
+{
+    GLuint texture = placeholder(sampling);
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        inFlight++;
+    }
+    ThreadPool::shared().submit([this, texture, path, sampling] { decode(texture, path, sampling); });
+    return texture;
+}
+
+/**
+ * @brief Creates a texture holding a 1x1 white texel, sampled without mipmaps until the real image lands.
+ */
+GLuint AsyncTextureLoader::placeholder(const TextureSampling &sampling)
+{
+    GLuint texture;
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    const unsigned char white[4] = {255, 255, 255, 255};
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, white);
+    // No mipmaps yet, so the default mipmapped minification filter would leave it incomplete
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, sampling.magFilter);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, sampling.wrap);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, sampling.wrap);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    return texture;
+}
+
+/**
+ * @brief Like request(), but the image comes from a generator run on the thread pool.
+ *
+ * @param label Name for log messages.
+ * @param generator Returns a complete RGBA8 mip chain, largest level first.
+ * @param sampling Wrap and filter modes for the uploaded image.
+ */
+GLuint AsyncTextureLoader::generate(const std::string &label, std::function<std::vector<CtexImage>()> generator,
+                                    const TextureSampling &sampling)
+{
+    GLuint texture = placeholder(sampling);
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        inFlight++;
+    }
+    ThreadPool::shared().submit([this, texture, label, generator, sampling] {
+        Image image = {texture, label, sampling, 0, 0, 4, nullptr, generator()};
+        if (!image.levels.empty())
+        {
+            image.width = image.levels[0].width;
+            image.height = image.levels[0].height;
+        }
+        std::lock_guard<std::mutex> lock(mutex);
+        ready.push_back(std::move(image));
+        inFlight--;
+        decoded.notify_all();
+    });
+    return texture;
+}
+
+/**
+ * @brief Worker side: decodes the file and queues the pixels for upload.
+ */
+void AsyncTextureLoader::decode(GLuint texture, const std::string &path, const TextureSampling &sampling)
+{
+    PROFILE_SCOPE("decode texture");
+    Image image = {texture, path, sampling, 0, 0, 0, nullptr, {}};
+    // The global flip flag is not thread safe; set it for this worker only
+    stbi_set_flip_vertically_on_load_thread(true);
+    Asset asset;
+    if (readAsset(path, asset))
+    {
+        image.pixels = stbi_load_from_memory(asset.data(), (int)asset.size(), &image.width, &image.height, &image.channels, 0);
+    }
+    if (!image.pixels)
+    {
+        image.width = image.height = 0;
+    }
+    else if (image.channels < 3)
+    {
+        // Grey images would only land in the red channel; expand them instead
+        stbi_image_free(image.pixels);
+        image.pixels = stbi_load_from_memory(asset.data(), (int)asset.size(), &image.width, &image.height, &image.channels, 4);
+        image.channels = 4;
+    }
+    dumpTexture(path, image.width, image.height, image.channels, image.pixels);
+
+    std::lock_guard<std::mutex> lock(mutex);
+    ready.push_back(image);
+    inFlight--;
+    decoded.notify_all();
+}
+
+/**
+ * @brief Copies one image into the next ring buffer and respecifies its texture from it.
+ *
+ * Decoded files bring level 0 and get their mipmaps generated; generated
+ * images bring their whole chain, which goes into the buffer back to back.
+ */
+void AsyncTextureLoader::upload(const Image &image)
+{
+    PROFILE_SCOPE("upload texture");
+    struct Level
+    {
+        int width;
+        int height;
+        const unsigned char *pixels;
+        GLsizeiptr offset;
+    };
+    std::vector<Level> levels;
+    GLsizeiptr size = 0;
+    if (image.levels.empty())
+    {
+        levels.push_back({image.width, image.height, image.pixels, 0});
+        size = (GLsizeiptr)image.width * image.height * image.channels;
+    }
+    for (const CtexImage &level : image.levels)
+    {
+        levels.push_back({level.width, level.height, level.pixels.data(), size});
+        size += (GLsizeiptr)level.pixels.size();
+    }
+    GLenum format = (image.channels == 4) ? GL_RGBA : GL_RGB;
+
+    if (pixelBuffers[0] == 0)
+        glGenBuffers(ringSize, pixelBuffers);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pixelBuffers[nextBuffer]);
+    nextBuffer = (nextBuffer + 1) % ringSize;
+
+    // Orphan the store so we never wait on a transfer the driver is still doing from it
+    glBufferData(GL_PIXEL_UNPACK_BUFFER, size, NULL, GL_STREAM_DRAW);
+    unsigned char *mapped = (unsigned char *)glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, size, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+    if (mapped)
+    {
+        for (size_t i = 0; i < levels.size(); i++)
+        {
+            GLsizeiptr end = i + 1 < levels.size() ? levels[i + 1].offset : size;
+            memcpy(mapped + levels[i].offset, levels[i].pixels, end - levels[i].offset);
+        }
+        glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+    }
+    else
+    {
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    }
+
+    glBindTexture(GL_TEXTURE_2D, image.texture);
+    // RGB rows are tightly packed and need not be 4-byte aligned
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    for (size_t i = 0; i < levels.size(); i++)
+    {
+        const void *source = mapped ? (const void *)(intptr_t)levels[i].offset : levels[i].pixels;
+        glTexImage2D(GL_TEXTURE_2D, (GLint)i, format, levels[i].width, levels[i].height, 0, format, GL_UNSIGNED_BYTE, source);
+    }
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    if (image.levels.empty())
+        glGenerateMipmap(GL_TEXTURE_2D);
+    else
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, (GLint)levels.size() - 1);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, image.sampling.minFilter);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+    printf("Texture loaded: %s (Width: %d, Height: %d, Channels: %d, Levels: %zu)\n",
+           image.path.c_str(), image.width, image.height, image.channels,
+           image.levels.empty() ? (size_t)0 : image.levels.size());
+}
+
+/**
+ * @brief Uploads decoded images until the frame's budget is spent. Call once per frame on the GL thread.
+ *
+ * At least one image is uploaded per call, so a single large texture cannot stall forever.
+ *
+ * @param budgetMs Upload time allowed this frame, in milliseconds.
+ */
+void AsyncTextureLoader::pump(double budgetMs)
+{
+    PROFILE_SCOPE("texture uploads");
+    auto start = std::chrono::steady_clock::now();
+    for (;;)
+    {
+        Image image;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (ready.empty())
+                return;
+            image = std::move(ready.front());
+            ready.pop_front();
+        }
+
+        if (image.pixels || !image.levels.empty())
+            upload(image);
+        else
+            fprintf(stderr, "Failed to load texture: %s\n", image.path.c_str());
+        if (onUploaded)
+            onUploaded(image.texture, image.width, image.height);
+        stbi_image_free(image.pixels);
+
+        std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+        if (elapsed.count() >= budgetMs)
+            return;
+    }
+}
+
+/**
+ * @brief Blocks until every requested texture has been decoded and uploaded.
+ */
+void AsyncTextureLoader::finish()
+{
+    for (;;)
+    {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            decoded.wait(lock, [this] { return inFlight == 0 || !ready.empty(); });
+            if (inFlight == 0 && ready.empty())
+                return;
+        }
+        pump(1e9);
+    }
+}
+
+/**
+ * @brief Waits for outstanding decodes and releases the upload buffers. Call before the context goes away.
+ */
+void AsyncTextureLoader::shutdown()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    decoded.wait(lock, [this] { return inFlight == 0; });
+    for (Image &image : ready)
+    {
+        stbi_image_free(image.pixels);
+    }
+    ready.clear();
+    if (pixelBuffers[0])
+    {
+        glDeleteBuffers(ringSize, pixelBuffers);
+        pixelBuffers[0] = pixelBuffers[1] = pixelBuffers[2] = 0;
+    }
+}
+
+/**
+ * @brief Number of requested textures that have not been uploaded yet.
+ */
+unsigned int AsyncTextureLoader::pending()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return inFlight + (unsigned int)ready.size();
+}
+
+/**
+ * @brief Loads a texture in the background; see AsyncTextureLoader::request().
+ */
+GLuint loadTextureAsync(const char *texturePath)
+{
+    return AsyncTextureLoader::instance().request(texturePath);
+}
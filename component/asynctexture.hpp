@@ -0,0 +1,81 @@
+#ifndef ASYNCTEXTURE_HPP
+#define ASYNCTEXTURE_HPP
+
+#include <GL/glew.h>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "ctex.hpp"
+
+/**
+ * @brief Texture parameters applied once the real image is uploaded.
+ */
+struct TextureSampling
+{
+    GLenum wrap = GL_CLAMP_TO_EDGE;
+    GLenum minFilter = GL_LINEAR_MIPMAP_LINEAR;
+    GLenum magFilter = GL_LINEAR;
+};
+
+/**
+ * @brief Streams textures in without blocking the render thread.
+ *
+ * request() hands back a texture name at once, holding a 1x1 white
+ * placeholder. The file is decoded on the shared ThreadPool and pump(),
+ * called once per frame on the GL thread, uploads finished images through a
+ * ring of pixel unpack buffers into the same texture name, so users never
+ * have to rebind anything.
+ */
+class AsyncTextureLoader
+{
+public:
+    static AsyncTextureLoader &instance();
+
+    GLuint request(const std::string &path, const TextureSampling &sampling = TextureSampling());
+    GLuint generate(const std::string &label, std::function<std::vector<CtexImage>()> generator,
+                    const TextureSampling &sampling = TextureSampling());
+    void pump(double budgetMs);
+    void finish();
+    void shutdown();
+
+    unsigned int pending();
+
+    // Called on the GL thread after each upload, or with 0x0 when decoding failed
+    std::function<void(GLuint texture, int width, int height)> onUploaded;
+
+private:
+    struct Image
+    {
+        GLuint texture;
+        std::string path;
+        TextureSampling sampling;
+        int width;
+        int height;
+        int channels;
+        unsigned char *pixels;         // Decoded level 0, from stb_image
+        std::vector<CtexImage> levels; // Or a generated RGBA8 mip chain
+    };
+
+    AsyncTextureLoader();
+    ~AsyncTextureLoader();
+
+    GLuint placeholder(const TextureSampling &sampling);
+    void decode(GLuint texture, const std::string &path, const TextureSampling &sampling);
+    void upload(const Image &image);
+
+    static const int ringSize = 3;
+
+    std::mutex mutex;
+    std::condition_variable decoded;
+    std::deque<Image> ready;
+    unsigned int inFlight;
+    GLuint pixelBuffers[ringSize];
+    int nextBuffer;
+};
+
+GLuint loadTextureAsync(const char *texturePath);
+
+#endif
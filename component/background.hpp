@@ -2,32 +2,28 @@
 #define BACKGROUND_HPP
 #include <GL/glew.h>
 #include "texture.hpp"
+#include "texturemanager.hpp"
 #include "shader.hpp"
+#include "shadervariants.hpp"
+#include "geometry.hpp"
+#include "collider.hpp"
 
 class Background
 {
 public:
-    GLfloat g_vertex_buffer_data[18];
-    GLfloat g_uv_buffer_data[12] = {
-        // 第一個三角形的 UV 座標
-        0.0f, 0.0f, // 左下角
-        1.0f, 0.0f, // 右下角
-        1.0f, 1.0f, // 右上角
-
-        // 第二個三角形的 UV 座標
-        0.0f, 0.0f, // 左下角
-        1.0f, 1.0f, // 右上角
-        0.0f, 1.0f  // 左上角
-    };
+    GLfloat scale = 5.0f; // Half the edge length of the floor quad
 
     GLuint VertexArrayID;
-    GLuint vertexbuffer;
-    GLuint uvbuffer;
+    const Mesh *mesh;
     GLuint programID;
+    const ShaderVariant *shader;
+    TextureHandle texture;
     GLuint textureID;
 
     Background();
+    ~Background();
     void render();
+    Collider collider() const;
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,411 @@
+#include "barneshut.hpp"
+#include "particlesys.hpp"
+#include "threadpool.hpp"
+#include "profiler.hpp"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <numeric>
+#include <type_traits>
+
+namespace
+{
+    const unsigned int mortonBits = 10;   // Per axis, so codes fit in 30 bits
+    const unsigned int parallelDepth = 2; // Subtrees below this level, up to 64 of them, are built in parallel
+    const size_t grain = 16384;
+    const size_t lanes = 8; // Partial sums per body in the force loop, enough for one AVX register
+
+    /**
+     * @brief Spreads the low 10 bits of v out to every third bit.
+     */
+    uint32_t expandBits(uint32_t v)
+    {
+        v = (v * 0x00010001u) & 0xFF0000FFu;
+        v = (v * 0x00000101u) & 0x0F00F00Fu;
+        v = (v * 0x00000011u) & 0xC30C30C3u;
+        v = (v * 0x00000005u) & 0x49249249u;
+        return v;
+    }
+
+    bool isLeaf(uint32_t begin, uint32_t end)
+    {
+        return end - begin <= BarnesHutTree::leafSize;
+    }
+}
+
+/**
+ * @brief Rebuilds the tree over the particles' current positions.
+ */
+void BarnesHutTree::build(const Particle *particles, size_t count)
+{
+    PROFILE_SCOPE("build barnes-hut tree");
+    nodes.clear();
+    maxDepth = 0;
+    if (count == 0)
+        return;
+    ThreadPool &pool = ThreadPool::shared();
+    size_t chunks = std::min<size_t>(64, (count + grain - 1) / grain);
+    size_t chunkSize = (count + chunks - 1) / chunks;
+    auto chunkEnd = [&](size_t chunk) { return std::min(count, (chunk + 1) * chunkSize); };
+
+    std::vector<glm::vec3> lows(chunks, glm::vec3(FLT_MAX)), highs(chunks, glm::vec3(-FLT_MAX));
+    pool.parallelFor(0, chunks, 1, [&](size_t begin, size_t end) {
+        for (size_t chunk = begin; chunk < end; chunk++)
+            for (size_t i = chunk * chunkSize; i < chunkEnd(chunk); i++)
+            {
+                lows[chunk] = glm::min(lows[chunk], particles[i].position);
+                highs[chunk] = glm::max(highs[chunk], particles[i].position);
+            }
+    });
+    glm::vec3 low = lows[0], high = highs[0];
+    for (size_t chunk = 1; chunk < chunks; chunk++)
+    {
+        low = glm::min(low, lows[chunk]);
+        high = glm::max(high, highs[chunk]);
+    }
+    glm::vec3 extent = high - low;
+    origin = low;
+    rootSize = std::max(std::max(extent.x, extent.y), extent.z) * 1.0001f + 1e-6f;
+
+    float scale = (1u << mortonBits) / rootSize;
+    const uint32_t maxCell = (1u << mortonBits) - 1;
+    codes.resize(count);
+    order.resize(count);
+    pool.parallelFor(0, count, grain, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++)
+        {
+            glm::vec3 cell = (particles[i].position - origin) * scale;
+            uint32_t x = std::min((uint32_t)cell.x, maxCell), y = std::min((uint32_t)cell.y, maxCell), z = std::min((uint32_t)cell.z, maxCell);
+            codes[i] = expandBits(x) << 2 | expandBits(y) << 1 | expandBits(z);
+            order[i] = (uint32_t)i;
+        }
+    });
+
+    sorter.sort(codes, order, 3 * mortonBits);
+
+    bodyX.resize(count);
+    bodyY.resize(count);
+    bodyZ.resize(count);
+    pool.parallelFor(0, count, grain, [&](size_t begin, size_t end) {
+        for (size_t k = begin; k < end; k++)
+        {
+            const glm::vec3 &position = particles[order[k]].position;
+            bodyX[k] = position.x;
+            bodyY[k] = position.y;
+            bodyZ[k] = position.z;
+        }
+    });
+
+    tasks.clear();
+    collectTasks(0, (uint32_t)count, 0);
+    subtrees.resize(tasks.size());
+    pool.parallelFor(0, tasks.size(), 1, [&](size_t begin, size_t end) {
+        for (size_t t = begin; t < end; t++)
+        {
+            subtrees[t].clear();
+            tasks[t].deepest = tasks[t].level;
+            buildSubtree(tasks[t].begin, tasks[t].end, tasks[t].level, subtrees[t], tasks[t].deepest);
+        }
+    });
+    size_t task = 0;
+    assemble(0, (uint32_t)count, 0, task);
+
+    leaves.clear();
+    for (uint32_t i = 0; i < (uint32_t)nodes.size(); i++)
+        if (nodes[i].skip == i + 1)
+            leaves.push_back(i);
+}
+
+/**
+ * @brief Finds where the children of a cell start in the sorted bodies; child d is bounds[d] to bounds[d + 1].
+ */
+void BarnesHutTree::split(uint32_t begin, uint32_t end, unsigned int level, uint32_t bounds[9]) const
+{
+    unsigned int shift = 3 * (mortonBits - 1 - level);
+    bounds[0] = begin;
+    for (uint32_t digit = 1; digit < 8; digit++)
+        bounds[digit] = (uint32_t)(std::partition_point(codes.begin() + bounds[digit - 1], codes.begin() + end,
+                                                        [&](uint32_t code) { return ((code >> shift) & 7) < digit; }) -
+                                   codes.begin());
+    bounds[8] = end;
+}
+
+/**
+ * @brief Adds a child's mass and mass-weighted centre to a node; the caller divides by the mass at the end.
+ */
+void BarnesHutTree::summarize(BarnesHutNode &node, const std::vector<BarnesHutNode> &source, uint32_t child) const
+{
+    const BarnesHutNode &other = source[child];
+    node.x += other.x * other.mass;
+    node.y += other.y * other.mass;
+    node.z += other.z * other.mass;
+    node.mass += other.mass;
+}
+
+/**
+ * @brief Squared longest side of the bounds of bodies begin to end; the axis of that side goes to longestAxis.
+ */
+float BarnesHutTree::boundsSize2(uint32_t begin, uint32_t end, int *longestAxis) const
+{
+    glm::vec3 low(FLT_MAX), high(-FLT_MAX);
+    for (uint32_t k = begin; k < end; k++)
+    {
+        glm::vec3 body(bodyX[k], bodyY[k], bodyZ[k]);
+        low = glm::min(low, body);
+        high = glm::max(high, body);
+    }
+    glm::vec3 extent = high - low;
+    int axis = extent.x >= extent.y && extent.x >= extent.z ? 0 : (extent.y >= extent.z ? 1 : 2);
+    if (longestAxis)
+        *longestAxis = axis;
+    return extent[axis] * extent[axis];
+}
+
+/**
+ * @brief Halves bodies begin to end at the median of the longest side of their bounds, reordering them in place.
+ *
+ * Used below the finest Morton level, where the codes no longer tell the
+ * bodies apart. Bodies on one spot are simply halved by index. Returns the
+ * first body of the upper half; size2 gets the bounds' squared longest side.
+ */
+uint32_t BarnesHutTree::splitMedian(uint32_t begin, uint32_t end, float &size2)
+{
+    int axis;
+    size2 = boundsSize2(begin, end, &axis);
+    const std::vector<float> &coordinates = axis == 0 ? bodyX : (axis == 1 ? bodyY : bodyZ);
+    std::vector<uint32_t> permutation(end - begin);
+    std::iota(permutation.begin(), permutation.end(), begin);
+    uint32_t middle = begin + (end - begin) / 2;
+    std::nth_element(permutation.begin(), permutation.begin() + (middle - begin), permutation.end(),
+                     [&](uint32_t a, uint32_t b) { return coordinates[a] < coordinates[b]; });
+    // The codes in the run are all equal, so only the positions and particle indices move
+    auto gather = [&](auto &values) {
+        std::vector<typename std::decay_t<decltype(values)>::value_type> moved(permutation.size());
+        for (size_t n = 0; n < permutation.size(); n++)
+            moved[n] = values[permutation[n]];
+        std::copy(moved.begin(), moved.end(), values.begin() + begin);
+    };
+    gather(bodyX);
+    gather(bodyY);
+    gather(bodyZ);
+    gather(order);
+    return middle;
+}
+
+/**
+ * @brief Builds the subtree over bodies begin to end into out, depth first. Returns its root's index in out.
+ *
+ * Subtrees cover disjoint runs of bodies, so they can be built in parallel
+ * even where splitMedian() reorders their bodies.
+ */
+uint32_t BarnesHutTree::buildSubtree(uint32_t begin, uint32_t end, unsigned int level, std::vector<BarnesHutNode> &out, unsigned int &deepest)
+{
+    uint32_t index = (uint32_t)out.size();
+    out.emplace_back();
+    BarnesHutNode node = {};
+    node.first = begin;
+    node.count = end - begin;
+    if (isLeaf(begin, end))
+    {
+        // The bodies' own bounds, so a leaf far enough away can be taken whole like any other node
+        node.size2 = boundsSize2(begin, end, nullptr);
+        for (uint32_t k = begin; k < end; k++)
+        {
+            node.x += bodyX[k];
+            node.y += bodyY[k];
+            node.z += bodyZ[k];
+        }
+        node.mass = (float)node.count;
+        deepest = std::max(deepest, level);
+    }
+    else if (level >= mortonBits)
+    {
+        uint32_t middle = splitMedian(begin, end, node.size2);
+        summarize(node, out, buildSubtree(begin, middle, level + 1, out, deepest));
+        summarize(node, out, buildSubtree(middle, end, level + 1, out, deepest));
+    }
+    else
+    {
+        float size = rootSize / (float)(1u << level);
+        node.size2 = size * size;
+        uint32_t bounds[9];
+        split(begin, end, level, bounds);
+        for (int child = 0; child < 8; child++)
+            if (bounds[child] < bounds[child + 1])
+                summarize(node, out, buildSubtree(bounds[child], bounds[child + 1], level + 1, out, deepest));
+    }
+    node.x /= node.mass;
+    node.y /= node.mass;
+    node.z /= node.mass;
+    node.skip = (uint32_t)out.size();
+    out[index] = node;
+    return index;
+}
+
+/**
+ * @brief Walks the top of the tree in the same order as assemble(), listing the subtrees to build in parallel.
+ */
+void BarnesHutTree::collectTasks(uint32_t begin, uint32_t end, unsigned int level)
+{
+    if (level == parallelDepth || isLeaf(begin, end))
+    {
+        tasks.push_back({begin, end, level, level});
+        return;
+    }
+    uint32_t bounds[9];
+    split(begin, end, level, bounds);
+    for (int child = 0; child < 8; child++)
+        if (bounds[child] < bounds[child + 1])
+            collectTasks(bounds[child], bounds[child + 1], level + 1);
+}
+
+/**
+ * @brief Emits the top of the tree and splices in the prebuilt subtrees, shifting their skip indices.
+ */
+uint32_t BarnesHutTree::assemble(uint32_t begin, uint32_t end, unsigned int level, size_t &task)
+{
+    if (level == parallelDepth || isLeaf(begin, end))
+    {
+        uint32_t base = (uint32_t)nodes.size();
+        maxDepth = std::max(maxDepth, tasks[task].deepest);
+        for (BarnesHutNode node : subtrees[task++])
+        {
+            node.skip += base;
+            nodes.push_back(node);
+        }
+        return base;
+    }
+    uint32_t index = (uint32_t)nodes.size();
+    nodes.emplace_back();
+    BarnesHutNode node = {};
+    node.first = begin;
+    node.count = end - begin;
+    float size = rootSize / (float)(1u << level);
+    node.size2 = size * size;
+    uint32_t bounds[9];
+    split(begin, end, level, bounds);
+    for (int child = 0; child < 8; child++)
+        if (bounds[child] < bounds[child + 1])
+            summarize(node, nodes, assemble(bounds[child], bounds[child + 1], level + 1, task));
+    node.x /= node.mass;
+    node.y /= node.mass;
+    node.z /= node.mass;
+    node.skip = (uint32_t)nodes.size();
+    nodes[index] = node;
+    return index;
+}
+
+/**
+ * @brief Adds every body's gravitational acceleration, over dt, to its particle's velocity.
+ *
+ * The tree is walked once per leaf rather than once per body. A node is taken
+ * whole when it is far enough from the nearest point of the leaf's bounds,
+ * which is as close as any of the leaf's bodies gets, and the bodies of leaves
+ * that are too close are listed one by one. Every body of the leaf then sums
+ * the same interaction list in a plain loop over packed arrays. Leaves are
+ * processed in Morton order on the thread pool, so neighbouring leaves, which
+ * open the same nodes, run on the same thread back to back.
+ *
+ * @param particles The particles the tree was built from.
+ */
+void BarnesHutTree::accelerate(Particle *particles, const NBodyParams &params, float dt) const
+{
+    PROFILE_SCOPE("barnes-hut forces");
+    float scale = params.gravity * params.totalMass / std::max<size_t>(order.size(), 1) * dt;
+    float softening2 = params.softening * params.softening;
+    float theta2 = params.theta * params.theta;
+    const BarnesHutNode *tree = nodes.data();
+    uint32_t nodeTotal = (uint32_t)nodes.size();
+    const float *xs = bodyX.data(), *ys = bodyY.data(), *zs = bodyZ.data();
+
+    ThreadPool::shared().parallelFor(0, leaves.size(), 64, [&](size_t begin, size_t end) {
+        // The interaction list: whole nodes and single bodies alike, as positions and masses
+        std::vector<float> listX, listY, listZ, listMass;
+        for (size_t l = begin; l < end; l++)
+        {
+            const BarnesHutNode &leaf = tree[leaves[l]];
+            float lowX = FLT_MAX, lowY = FLT_MAX, lowZ = FLT_MAX, highX = -FLT_MAX, highY = -FLT_MAX, highZ = -FLT_MAX;
+            for (uint32_t k = leaf.first; k < leaf.first + leaf.count; k++)
+            {
+                lowX = std::min(lowX, xs[k]);
+                lowY = std::min(lowY, ys[k]);
+                lowZ = std::min(lowZ, zs[k]);
+                highX = std::max(highX, xs[k]);
+                highY = std::max(highY, ys[k]);
+                highZ = std::max(highZ, zs[k]);
+            }
+
+            listX.clear();
+            listY.clear();
+            listZ.clear();
+            listMass.clear();
+            uint32_t i = 0;
+            while (i < nodeTotal)
+            {
+                const BarnesHutNode &node = tree[i];
+                float dx = std::max(std::max(lowX - node.x, node.x - highX), 0.0f);
+                float dy = std::max(std::max(lowY - node.y, node.y - highY), 0.0f);
+                float dz = std::max(std::max(lowZ - node.z, node.z - highZ), 0.0f);
+                float distance2 = dx * dx + dy * dy + dz * dz;
+                // A node holding the leaf is always opened, so no body pulls on itself through a centre of mass
+                bool holdsLeaf = leaf.first - node.first < node.count;
+                if (!holdsLeaf && node.size2 <= theta2 * distance2)
+                {
+                    listX.push_back(node.x);
+                    listY.push_back(node.y);
+                    listZ.push_back(node.z);
+                    listMass.push_back(node.mass);
+                    i = node.skip;
+                }
+                else if (node.skip == i + 1)
+                {
+                    for (uint32_t j = node.first; j < node.first + node.count; j++)
+                    {
+                        listX.push_back(xs[j]);
+                        listY.push_back(ys[j]);
+                        listZ.push_back(zs[j]);
+                        listMass.push_back(1.0f);
+                    }
+                    i = node.skip;
+                }
+                else
+                {
+                    i++;
+                }
+            }
+
+            // Massless padding to whole groups of lanes
+            while (listMass.size() % lanes)
+            {
+                listX.push_back(0.0f);
+                listY.push_back(0.0f);
+                listZ.push_back(0.0f);
+                listMass.push_back(0.0f);
+            }
+            size_t listSize = listMass.size();
+            const float *nx = listX.data(), *ny = listY.data(), *nz = listZ.data(), *mass = listMass.data();
+            for (uint32_t k = leaf.first; k < leaf.first + leaf.count; k++)
+            {
+                float px = xs[k], py = ys[k], pz = zs[k];
+                // One partial sum per lane, so the lanes are independent and the loop needs no reassociation to vectorize
+                float ax[lanes] = {}, ay[lanes] = {}, az[lanes] = {};
+                // The body's own term is zero: its offset is zero and the softening keeps the divisor finite
+                for (size_t n = 0; n < listSize; n += lanes)
+                    for (size_t lane = 0; lane < lanes; lane++)
+                    {
+                        float dx = nx[n + lane] - px, dy = ny[n + lane] - py, dz = nz[n + lane] - pz;
+                        float inverse = 1.0f / std::sqrt(dx * dx + dy * dy + dz * dz + softening2);
+                        float weight = mass[n + lane] * inverse * inverse * inverse;
+                        ax[lane] += dx * weight;
+                        ay[lane] += dy * weight;
+                        az[lane] += dz * weight;
+                    }
+                glm::vec3 acceleration(0.0f);
+                for (size_t lane = 0; lane < lanes; lane++)
+                    acceleration += glm::vec3(ax[lane], ay[lane], az[lane]);
+                particles[order[k]].velocity += acceleration * scale;
+            }
+        }
+    });
+}
@@ -0,0 +1,96 @@
+#ifndef BARNESHUT_HPP
+#define BARNESHUT_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+#include "radixsort.hpp"
+
+struct Particle;
+
+/**
+ * @brief Settings for SIM_NBODY. The bodies share the total mass equally, so the motion doesn't depend on their count.
+ */
+struct NBodyParams
+{
+    float gravity = 1.0f;    // Gravitational constant
+    float totalMass = 10.0f;
+    float theta = 0.6f;      // Opening angle: a cell whose size over distance is below this is taken whole
+    float softening = 0.05f; // Plummer softening length, which keeps close encounters finite
+    float discRadius = 4.0f; // The bodies start as a rotating disc at discHeight
+    float discHeight = 2.5f;
+};
+
+/**
+ * @brief One octree cell, in depth-first order. 32 bytes, so two share a cache line.
+ */
+struct BarnesHutNode
+{
+    float x, y, z; // Centre of mass
+    float mass;
+    float size2;    // Squared edge of the cell, or of the bodies' bounds below the finest cells and in leaves
+    uint32_t skip;  // Index of the next node once this subtree is done with; the node's own index plus one for a leaf
+    uint32_t first; // First body of the subtree, in Morton order
+    uint32_t count; // Bodies in the subtree
+};
+
+/**
+ * @brief Barnes-Hut octree over a set of equal-mass bodies, rebuilt every step.
+ *
+ * build() sorts the bodies by the Morton code of their position with
+ * RadixSort, so every octree cell is a contiguous run of them, and splits the
+ * octree top-down along the sorted codes. This stands in for a bottom-up
+ * radix tree build: the octant boundaries in the sorted codes give the octree
+ * directly. The top of the tree is split serially; the subtrees below it are
+ * built in parallel and stitched into one array in depth-first order, with
+ * the masses and centres of mass summed bottom-up. Cells at the finest Morton
+ * level that still hold more than leafSize bodies are halved at the median of
+ * their longest side until they don't, so bodies piled on one spot don't make
+ * a leaf that every one of them sums directly.
+ *
+ * Each node stores the index just past its subtree, so accelerate() walks the
+ * tree without a stack, once per leaf: take a node whole if it is far enough
+ * from the leaf, leaves included, otherwise step into its first child or list
+ * a leaf's bodies. The leaf's bodies then share the resulting interaction list.
+ */
+class BarnesHutTree
+{
+public:
+    void build(const Particle *particles, size_t count);
+    void accelerate(Particle *particles, const NBodyParams &params, float dt) const;
+
+    size_t nodeCount() const { return nodes.size(); }
+    unsigned int depth() const { return maxDepth; }
+
+    static const unsigned int leafSize = 8;
+
+private:
+    uint32_t buildSubtree(uint32_t begin, uint32_t end, unsigned int level, std::vector<BarnesHutNode> &out, unsigned int &deepest);
+    uint32_t splitMedian(uint32_t begin, uint32_t end, float &size2);
+    float boundsSize2(uint32_t begin, uint32_t end, int *longestAxis) const;
+    void collectTasks(uint32_t begin, uint32_t end, unsigned int level);
+    uint32_t assemble(uint32_t begin, uint32_t end, unsigned int level, size_t &task);
+    void split(uint32_t begin, uint32_t end, unsigned int level, uint32_t bounds[9]) const;
+    void summarize(BarnesHutNode &node, const std::vector<BarnesHutNode> &source, uint32_t child) const;
+
+    struct Task
+    {
+        uint32_t begin, end;
+        unsigned int level;
+        unsigned int deepest; // Level of the subtree's deepest leaf
+    };
+
+    glm::vec3 origin;
+    float rootSize = 1.0f;
+    unsigned int maxDepth = 0;
+    std::vector<uint32_t> codes, order; // Sorted Morton codes and the particle each belongs to
+    RadixSort sorter;
+    std::vector<float> bodyX, bodyY, bodyZ; // Positions in Morton order
+    std::vector<Task> tasks;
+    std::vector<std::vector<BarnesHutNode>> subtrees;
+    std::vector<BarnesHutNode> nodes;
+    std::vector<uint32_t> leaves; // Node index of every leaf, in Morton order
+};
+
+#endif
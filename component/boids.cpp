@@ -0,0 +1,139 @@
+#include "boids.hpp"
+#include "particlesys.hpp"
+#include "profiler.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+    const size_t boidGrain = 2048;
+}
+
+/**
+ * @brief Adds one step of steering to every boid's velocity and keeps its speed within range.
+ *
+ * @param grid Built over particles with a cell of at least params.perceptionRadius.
+ * @param colliders Obstacles to steer around; the collision pass still resolves any contact.
+ */
+void BoidFlock::step(std::vector<Particle> &particles, const SpatialGrid &grid, const std::vector<Collider> &colliders,
+                     const BoidParams &params, float dt)
+{
+    PROFILE_SCOPE("boids step");
+    size_t count = particles.size();
+    for (std::vector<float> *column : {&px, &py, &pz, &vx, &vy, &vz, &ax, &ay, &az})
+        column->resize(count);
+
+    ThreadPool &pool = ThreadPool::shared();
+    pool.parallelFor(0, count, boidGrain * 8, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++)
+        {
+            const Particle &p = particles[i];
+            px[i] = p.position.x;
+            py[i] = p.position.y;
+            pz[i] = p.position.z;
+            vx[i] = p.velocity.x;
+            vy[i] = p.velocity.y;
+            vz[i] = p.velocity.z;
+        }
+    });
+
+    float perception2 = params.perceptionRadius * params.perceptionRadius;
+    float separation2 = params.separationRadius * params.separationRadius;
+    unsigned int maxNeighbors = std::min(std::max(params.maxNeighbors, 1u), boidNeighborLimit);
+    pool.parallelFor(0, count, boidGrain, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++)
+        {
+            float x = px[i], y = py[i], z = pz[i];
+            // The nearest neighbours so far; once there are enough, only closer ones replace the farthest
+            float nearDistance[boidNeighborLimit];
+            uint32_t nearIndex[boidNeighborLimit];
+            unsigned int found = 0, farthest = 0;
+            float reach2 = perception2;
+            grid.forEachCandidateWithin(glm::vec3(x, y, z), [&]() { return reach2; }, [&](size_t j) {
+                if (j == i)
+                    return;
+                float dx = px[j] - x, dy = py[j] - y, dz = pz[j] - z;
+                float distance2 = dx * dx + dy * dy + dz * dz;
+                if (distance2 >= reach2)
+                    return;
+                unsigned int slot = found < maxNeighbors ? found++ : farthest;
+                nearDistance[slot] = distance2;
+                nearIndex[slot] = (uint32_t)j;
+                if (found < maxNeighbors)
+                    return;
+                farthest = 0;
+                for (unsigned int n = 1; n < found; n++)
+                    if (nearDistance[n] > nearDistance[farthest])
+                        farthest = n;
+                reach2 = nearDistance[farthest];
+            });
+
+            float alignX = 0.0f, alignY = 0.0f, alignZ = 0.0f;  // Sum of neighbour velocities
+            float centreX = 0.0f, centreY = 0.0f, centreZ = 0.0f; // Sum of offsets to neighbours
+            float apartX = 0.0f, apartY = 0.0f, apartZ = 0.0f;  // Away from close neighbours, stronger the closer they are
+            for (unsigned int n = 0; n < found; n++)
+            {
+                float distance2 = nearDistance[n];
+                uint32_t j = nearIndex[n];
+                float dx = px[j] - x, dy = py[j] - y, dz = pz[j] - z;
+                alignX += vx[j];
+                alignY += vy[j];
+                alignZ += vz[j];
+                centreX += dx;
+                centreY += dy;
+                centreZ += dz;
+                if (distance2 < separation2 && distance2 > 0.0f)
+                {
+                    float weight = separation2 / distance2 - 1.0f;
+                    apartX -= dx * weight;
+                    apartY -= dy * weight;
+                    apartZ -= dz * weight;
+                }
+            }
+
+            glm::vec3 steer(0.0f);
+            if (found)
+            {
+                float inverse = 1.0f / found;
+                steer += (glm::vec3(alignX, alignY, alignZ) * inverse - glm::vec3(vx[i], vy[i], vz[i])) * params.alignment;
+                steer += glm::vec3(centreX, centreY, centreZ) * (inverse * params.cohesion);
+                steer += glm::vec3(apartX, apartY, apartZ) * (params.separation / params.separationRadius);
+            }
+            glm::vec3 position(x, y, z);
+            for (const Collider &collider : colliders)
+            {
+                glm::vec3 closest = glm::clamp(position, collider.boundsMin, collider.boundsMax);
+                glm::vec3 gap = position - closest;
+                if (glm::dot(gap, gap) >= params.avoidDistance * params.avoidDistance)
+                    continue;
+                glm::vec3 normal;
+                float distance = collider.distance(position, normal);
+                if (distance < params.avoidDistance)
+                    steer += normal * (params.avoidance * (1.0f - std::max(distance, 0.0f) / params.avoidDistance));
+            }
+            steer += (glm::clamp(position, params.regionMin, params.regionMax) - position) * params.containment;
+
+            float length2 = glm::dot(steer, steer);
+            if (length2 > params.maxSteer * params.maxSteer)
+                steer *= params.maxSteer / std::sqrt(length2);
+            ax[i] = steer.x;
+            ay[i] = steer.y;
+            az[i] = steer.z;
+        }
+    });
+
+    // Applied afterwards, since the pass above reads every neighbour's velocity
+    pool.parallelFor(0, count, boidGrain * 8, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++)
+        {
+            glm::vec3 velocity(vx[i] + ax[i] * dt, vy[i] + ay[i] * dt, vz[i] + az[i] * dt);
+            float speed = std::sqrt(glm::dot(velocity, velocity));
+            if (speed > params.maxSpeed)
+                velocity *= params.maxSpeed / speed;
+            else if (speed < params.minSpeed)
+                velocity = speed > 0.0f ? velocity * (params.minSpeed / speed) : glm::vec3(params.minSpeed, 0.0f, 0.0f);
+            particles[i].velocity = velocity;
+        }
+    });
+}
@@ -0,0 +1,58 @@
+#ifndef BOIDS_HPP
+#define BOIDS_HPP
+
+#include <vector>
+#include <glm/glm.hpp>
+#include "collider.hpp"
+#include "spatialgrid.hpp"
+
+struct Particle;
+
+const unsigned int boidNeighborLimit = 32;
+
+/**
+ * @brief Flocking settings for SIM_BOIDS. The weights scale each rule's acceleration.
+ */
+struct BoidParams
+{
+    float perceptionRadius = 0.4f;  // Neighbours closer than this steer a boid; also the grid cell
+    float separationRadius = 0.15f; // Neighbours closer than this push it away
+    unsigned int maxNeighbors = 12; // Only the nearest this many steer a boid, up to boidNeighborLimit
+    float separation = 1.5f;
+    float alignment = 2.0f;
+    float cohesion = 1.5f;
+    float avoidance = 20.0f;        // Push away from colliders at contact, fading out at avoidDistance
+    float avoidDistance = 0.6f;
+    float containment = 2.0f;       // Pull back towards the region per unit of distance outside it
+    float minSpeed = 1.0f;
+    float maxSpeed = 3.0f;
+    float maxSteer = 10.0f;         // Longest acceleration the rules add up to
+    glm::vec3 regionMin = glm::vec3(-4.0f, -4.0f, 0.5f); // Boids start in this box and turn back towards it
+    glm::vec3 regionMax = glm::vec3(4.0f, 4.0f, 4.0f);
+};
+
+/**
+ * @brief Reynolds flocking on top of the particle storage.
+ *
+ * Each step copies the positions and velocities into packed arrays, then a
+ * parallel pass finds each boid's neighbours through a SpatialGrid built over
+ * the same particles and sums separation, alignment and cohesion over the
+ * nearest BoidParams::maxNeighbors of them. Cells beyond the farthest of those
+ * are skipped, so a crowded flock costs little more per boid than a sparse one,
+ * and the result doesn't depend on the order the cells are visited in.
+ * Colliders within avoidDistance push the boid along their normal, and a last
+ * pass clamps the steering and the speed before writing the velocities back.
+ */
+class BoidFlock
+{
+public:
+    void step(std::vector<Particle> &particles, const SpatialGrid &grid, const std::vector<Collider> &colliders,
+              const BoidParams &params, float dt);
+
+private:
+    std::vector<float> px, py, pz; // Positions and velocities, in particle order
+    std::vector<float> vx, vy, vz;
+    std::vector<float> ax, ay, az; // Steering from the last step
+};
+
+#endif
@@ -0,0 +1,265 @@
+#include "collider.hpp"
+#include "particlesys.hpp"
+
+#include <cfloat>
+#include <cmath>
+
+namespace
+{
+    bool overlaps(const glm::vec3 &minA, const glm::vec3 &maxA, const glm::vec3 &minB, const glm::vec3 &maxB)
+    {
+        return minA.x <= maxB.x && maxA.x >= minB.x && minA.y <= maxB.y && maxA.y >= minB.y &&
+               minA.z <= maxB.z && maxA.z >= minB.z;
+    }
+
+    // Signed distance from a point to each shape, positive outside, with the outward normal
+
+    struct Plane
+    {
+        glm::vec3 point, normal;
+        float distance(const glm::vec3 &p, glm::vec3 &n) const
+        {
+            n = normal;
+            return glm::dot(p - point, normal);
+        }
+    };
+
+    struct Sphere
+    {
+        glm::vec3 centre;
+        float radius;
+        float distance(const glm::vec3 &p, glm::vec3 &n) const
+        {
+            glm::vec3 d = p - centre;
+            float length = std::sqrt(glm::dot(d, d));
+            n = length > 0.0f ? d / length : glm::vec3(0.0f, 0.0f, 1.0f);
+            return length - radius;
+        }
+    };
+
+    struct Box
+    {
+        glm::vec3 centre, half;
+        float distance(const glm::vec3 &p, glm::vec3 &n) const
+        {
+            glm::vec3 d = p - centre;
+            glm::vec3 q = glm::abs(d) - half;
+            glm::vec3 outside = glm::max(q, glm::vec3(0.0f));
+            float length = std::sqrt(glm::dot(outside, outside));
+            if (length > 0.0f)
+            {
+                n = glm::vec3(d.x < 0.0f ? -outside.x : outside.x, d.y < 0.0f ? -outside.y : outside.y,
+                              d.z < 0.0f ? -outside.z : outside.z) / length;
+                return length;
+            }
+            // Inside: leave through the nearest face
+            int axis = q.x > q.y ? (q.x > q.z ? 0 : 2) : (q.y > q.z ? 1 : 2);
+            n = glm::vec3(0.0f);
+            n[axis] = d[axis] < 0.0f ? -1.0f : 1.0f;
+            return q[axis];
+        }
+    };
+
+    struct Capsule
+    {
+        glm::vec3 start, axis; // axis = end - start
+        float inverseLength2, radius;
+        float distance(const glm::vec3 &p, glm::vec3 &n) const
+        {
+            float t = glm::clamp(glm::dot(p - start, axis) * inverseLength2, 0.0f, 1.0f);
+            glm::vec3 d = p - (start + axis * t);
+            float length = std::sqrt(glm::dot(d, d));
+            n = length > 0.0f ? d / length : glm::vec3(0.0f, 0.0f, 1.0f);
+            return length - radius;
+        }
+    };
+
+    struct Field
+    {
+        const DistanceField *field;
+        float distance(const glm::vec3 &p, glm::vec3 &n) const
+        {
+            float d = field->sample(p, n);
+            float length = std::sqrt(glm::dot(n, n));
+            if (length > 0.0f)
+            {
+                n /= length;
+                return d;
+            }
+            // Beyond the band there is no gradient; push a particle that got that deep out away from the centre
+            n = p - (field->boundsMin() + field->boundsMax()) * 0.5f;
+            length = std::sqrt(glm::dot(n, n));
+            n = length > 0.0f ? n / length : glm::vec3(0.0f, 0.0f, 1.0f);
+            return d;
+        }
+    };
+
+    /**
+     * @brief Calls visit with the collider's shape, built from its parameters, and returns what visit returns.
+     */
+    template <typename Visit>
+    auto visitShape(const Collider &collider, Visit &&visit)
+    {
+        switch (collider.shape)
+        {
+        case COLLIDER_SPHERE:
+            return visit(Sphere{collider.a, collider.radius});
+        case COLLIDER_BOX:
+            return visit(Box{(collider.a + collider.b) * 0.5f, (collider.b - collider.a) * 0.5f});
+        case COLLIDER_CAPSULE:
+        {
+            glm::vec3 axis = collider.b - collider.a;
+            float length2 = glm::dot(axis, axis);
+            return visit(Capsule{collider.a, axis, length2 > 0.0f ? 1.0f / length2 : 0.0f, collider.radius});
+        }
+        case COLLIDER_FIELD:
+            return visit(Field{collider.field.get()});
+        case COLLIDER_PLANE:
+            break;
+        }
+        return visit(Plane{collider.a, collider.b});
+    }
+
+    /**
+     * @brief One pass of a collider over the particles, with the shape test inlined.
+     */
+    template <typename Shape>
+    void collide(Collider &collider, const Shape &shape, Particle *particles, size_t count,
+                 std::vector<unsigned int> &killed, CollisionCounts &counts)
+    {
+        for (size_t i = 0; i < count; i++)
+        {
+            Particle &p = particles[i];
+            // Expired particles are respawned after this pass anyway
+            if (p.lifetime <= 0.0f)
+                continue;
+            glm::vec3 margin(p.size);
+            if (!overlaps(p.position - margin, p.position + margin, collider.boundsMin, collider.boundsMax))
+                continue;
+            glm::vec3 normal;
+            float distance = shape.distance(p.position, normal);
+            if (distance >= p.size)
+                continue;
+
+            collider.contacts++;
+            counts.contacts++;
+            if (collider.response == COLLIDE_KILL)
+            {
+                p.lifetime = 0.0f;
+                killed.push_back((unsigned int)i);
+                counts.kills++;
+                continue;
+            }
+            p.position += normal * (p.size - distance);
+            float normalSpeed = glm::dot(p.velocity, normal);
+            if (normalSpeed < 0.0f)
+            {
+                glm::vec3 tangential = p.velocity - normal * normalSpeed;
+                p.velocity = tangential * (1.0f - collider.friction) - normal * (normalSpeed * collider.restitution);
+            }
+        }
+    }
+
+    Collider base(ColliderShape shape)
+    {
+        Collider collider;
+        collider.shape = shape;
+        collider.a = collider.b = glm::vec3(0.0f);
+        collider.boundsMin = glm::vec3(-FLT_MAX);
+        collider.boundsMax = glm::vec3(FLT_MAX);
+        return collider;
+    }
+}
+
+/**
+ * @brief Everything below the plane is solid. Limit boundsMin/boundsMax to make a finite floor.
+ */
+Collider Collider::plane(const glm::vec3 &point, const glm::vec3 &normal)
+{
+    Collider collider = base(COLLIDER_PLANE);
+    collider.a = point;
+    collider.b = glm::normalize(normal);
+    return collider;
+}
+
+Collider Collider::sphere(const glm::vec3 &centre, float radius)
+{
+    Collider collider = base(COLLIDER_SPHERE);
+    collider.a = centre;
+    collider.radius = radius;
+    collider.boundsMin = centre - glm::vec3(radius);
+    collider.boundsMax = centre + glm::vec3(radius);
+    return collider;
+}
+
+Collider Collider::box(const glm::vec3 &minimum, const glm::vec3 &maximum)
+{
+    Collider collider = base(COLLIDER_BOX);
+    collider.a = minimum;
+    collider.b = maximum;
+    collider.boundsMin = minimum;
+    collider.boundsMax = maximum;
+    return collider;
+}
+
+Collider Collider::capsule(const glm::vec3 &start, const glm::vec3 &end, float radius)
+{
+    Collider collider = base(COLLIDER_CAPSULE);
+    collider.a = start;
+    collider.b = end;
+    collider.radius = radius;
+    collider.boundsMin = glm::min(start, end) - glm::vec3(radius);
+    collider.boundsMax = glm::max(start, end) + glm::vec3(radius);
+    return collider;
+}
+
+/**
+ * @brief A mesh baked by sdfbake. Only the sampled region collides; the band limits how deep a contact is seen.
+ */
+Collider Collider::distanceField(std::shared_ptr<const DistanceField> field)
+{
+    Collider collider = base(COLLIDER_FIELD);
+    collider.boundsMin = field->boundsMin();
+    collider.boundsMax = field->boundsMax();
+    collider.field = std::move(field);
+    return collider;
+}
+
+/**
+ * @brief Signed distance from point to the surface, positive outside, for queries outside the collision pass.
+ *
+ * Uses the same shape tests as the collision pass, so a point deep inside a
+ * distance field still gets a normal leading out of it.
+ *
+ * @param normal Receives the outward unit normal.
+ */
+float Collider::distance(const glm::vec3 &point, glm::vec3 &normal) const
+{
+    return visitShape(*this, [&](const auto &shape) { return shape.distance(point, normal); });
+}
+
+/**
+ * @brief Resolves contacts between the particles and every collider, after integration.
+ *
+ * A collider whose broad-phase box misses the particles' bounds is skipped
+ * outright; otherwise each particle is checked against the box before the
+ * exact test.
+ *
+ * @param particlesMin Lower corner of the particle positions, grown by the largest particle size.
+ * @param particlesMax Upper corner, likewise.
+ * @param killed Receives the indices of particles killed by COLLIDE_KILL colliders.
+ */
+void collideParticles(std::vector<Collider> &colliders, Particle *particles, size_t count, const glm::vec3 &particlesMin,
+                      const glm::vec3 &particlesMax, std::vector<unsigned int> &killed, CollisionCounts &counts)
+{
+    for (Collider &collider : colliders)
+    {
+        if (!overlaps(particlesMin, particlesMax, collider.boundsMin, collider.boundsMax))
+        {
+            counts.skipped++;
+            continue;
+        }
+        counts.tested++;
+        visitShape(collider, [&](const auto &shape) { collide(collider, shape, particles, count, killed, counts); });
+    }
+}
@@ -0,0 +1,71 @@
+#ifndef COLLIDER_HPP
+#define COLLIDER_HPP
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+#include <glm/glm.hpp>
+#include "distancefield.hpp"
+
+struct Particle;
+
+enum ColliderShape
+{
+    COLLIDER_PLANE,   // Half-space below a plane
+    COLLIDER_SPHERE,
+    COLLIDER_BOX,     // Axis-aligned
+    COLLIDER_CAPSULE, // Segment with a radius
+    COLLIDER_FIELD,   // Static mesh baked into a signed distance field
+};
+
+enum ColliderResponse
+{
+    COLLIDE_BOUNCE, // Reflect with restitution and friction
+    COLLIDE_KILL,   // End the particle's life on contact
+};
+
+/**
+ * @brief A static collision primitive. Build with the factories, then adjust the response.
+ *
+ * Particles are treated as spheres of their size. Each collider carries a
+ * broad-phase box; particles outside it skip the exact test, and when the box
+ * doesn't overlap the bounds of the whole system, the collider is skipped.
+ */
+struct Collider
+{
+    ColliderShape shape;
+    ColliderResponse response = COLLIDE_BOUNCE;
+    glm::vec3 a;              // Plane point, sphere centre, box minimum or capsule start
+    glm::vec3 b;              // Plane normal (unit length), box maximum or capsule end
+    float radius = 0.0f;      // Sphere and capsule
+    std::shared_ptr<const DistanceField> field;
+    float restitution = 0.4f; // Fraction of the normal speed kept by a bounce
+    float friction = 0.2f;    // Fraction of the tangential speed lost by a bounce
+    glm::vec3 boundsMin;      // Broad phase; unbounded for planes unless set
+    glm::vec3 boundsMax;
+    unsigned long long contacts = 0; // Contacts since creation
+
+    static Collider plane(const glm::vec3 &point, const glm::vec3 &normal);
+    static Collider sphere(const glm::vec3 &centre, float radius);
+    static Collider box(const glm::vec3 &minimum, const glm::vec3 &maximum);
+    static Collider capsule(const glm::vec3 &start, const glm::vec3 &end, float radius);
+    static Collider distanceField(std::shared_ptr<const DistanceField> field);
+
+    float distance(const glm::vec3 &point, glm::vec3 &normal) const;
+};
+
+/**
+ * @brief Collision counters, accumulated across passes into ParticleStats.
+ */
+struct CollisionCounts
+{
+    unsigned long long contacts = 0;
+    unsigned long long kills = 0;
+    unsigned long long tested = 0;  // Collider passes run
+    unsigned long long skipped = 0; // Collider passes rejected by the broad phase
+};
+
+void collideParticles(std::vector<Collider> &colliders, Particle *particles, size_t count, const glm::vec3 &particlesMin,
+                      const glm::vec3 &particlesMax, std::vector<unsigned int> &killed, CollisionCounts &counts);
+
+#endif
@@ -0,0 +1,87 @@
+#include "cookedtexture.hpp"
+#include "ctex.hpp"
+#include "assetpack.hpp"
+#include "profiler.hpp"
+
+#include <stdio.h>
+#include <filesystem>
+
+/**
+ * @brief True if the cooked file exists and is not older than its source image.
+ *
+ * A missing source counts as current, so cooked files can ship without the originals.
+ * Cooked files in the asset pack are always current; the pack is rebuilt with them.
+ */
+bool cookedTextureCurrent(const std::string &cookedPath, const std::string &sourcePath)
+{
+    if (assetBuiltIn(cookedPath))
+        return true;
+
+    std::error_code error;
+    auto cookedTime = std::filesystem::last_write_time(cookedPath, error);
+    if (error)
+        return false;
+    auto sourceTime = std::filesystem::last_write_time(sourcePath, error);
+    if (error)
+        return true;
+    if (cookedTime < sourceTime)
+    {
+        fprintf(stderr, "%s is older than %s, run texcook again\n", cookedPath.c_str(), sourcePath.c_str());
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Uploads every mip level of a .ctex file into the texture.
+ *
+ * Block-compressed levels go straight from the mapped file to
+ * glCompressedTexImage2D. Drivers without S3TC get the levels decoded to RGBA8
+ * on the CPU, which costs the memory savings but still skips mip generation.
+ *
+ * @return Bytes of GPU memory used by the levels, or 0 if the file could not be loaded.
+ */
+size_t loadCookedTexture(const std::string &cookedPath, GLuint texture, const TextureSampling &sampling)
+{
+    PROFILE_SCOPE("loadCookedTexture");
+    CtexFile file;
+    if (!file.open(cookedPath))
+        return 0;
+
+    const CtexHeader &header = file.header();
+    CtexFormat format = (CtexFormat)header.format;
+    bool compressed = format != CTEX_RGBA8 && GLEW_EXT_texture_compression_s3tc;
+    GLenum internalFormat = format == CTEX_BC1 ? GL_COMPRESSED_RGB_S3TC_DXT1_EXT : GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    size_t bytes = 0;
+    for (unsigned int i = 0; i < header.levels; i++)
+    {
+        const CtexLevel &level = file.level(i);
+        if (compressed)
+        {
+            glCompressedTexImage2D(GL_TEXTURE_2D, i, internalFormat, level.width, level.height, 0, level.size, file.levelData(i));
+            bytes += level.size;
+        }
+        else
+        {
+            CtexImage image = ctexDecode(format, level.width, level.height, file.levelData(i));
+            glTexImage2D(GL_TEXTURE_2D, i, GL_RGBA, level.width, level.height, 0, GL_RGBA, GL_UNSIGNED_BYTE, image.pixels.data());
+            bytes += image.pixels.size();
+        }
+    }
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, header.levels - 1);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, sampling.minFilter);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, sampling.magFilter);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, sampling.wrap);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, sampling.wrap);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    printf("Texture loaded: %s (Width: %u, Height: %u, Levels: %u, %s)\n", cookedPath.c_str(),
+           header.width, header.height, header.levels,
+           compressed ? (format == CTEX_BC1 ? "BC1" : "BC3") : "RGBA8");
+    return bytes;
+}
@@ -0,0 +1,13 @@
+#ifndef COOKEDTEXTURE_HPP
+#define COOKEDTEXTURE_HPP
+
+#include <GL/glew.h>
+#include <cstddef>
+#include <string>
+#include "asynctexture.hpp"
+#include "ctex.hpp"
+
+bool cookedTextureCurrent(const std::string &cookedPath, const std::string &sourcePath);
+size_t loadCookedTexture(const std::string &cookedPath, GLuint texture, const TextureSampling &sampling);
+
+#endif
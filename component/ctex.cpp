@@ -0,0 +1,461 @@
+#include "ctex.hpp"
+
+#include <stdio.h>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+
+
+namespace
+{
+    const size_t levelAlignment = 16;
+
+    uint16_t pack565(const float color[3])
+    {
+        int r = std::min(31, std::max(0, (int)std::lround(color[0] * 31.0f / 255.0f)));
+        int g = std::min(63, std::max(0, (int)std::lround(color[1] * 63.0f / 255.0f)));
+        int b = std::min(31, std::max(0, (int)std::lround(color[2] * 31.0f / 255.0f)));
+        return (uint16_t)((r << 11) | (g << 5) | b);
+    }
+
+    void unpack565(uint16_t packed, int color[3])
+    {
+        int r = (packed >> 11) & 31, g = (packed >> 5) & 63, b = packed & 31;
+        color[0] = (r << 3) | (r >> 2);
+        color[1] = (g << 2) | (g >> 4);
+        color[2] = (b << 3) | (b >> 2);
+    }
+
+    /**
+     * @brief Gathers a 4x4 RGBA block, replicating edge pixels past the image border.
+     */
+    void fetchBlock(const CtexImage &image, int blockX, int blockY, unsigned char block[64])
+    {
+        for (int y = 0; y < 4; y++)
+        {
+            int sy = std::min(blockY * 4 + y, image.height - 1);
+            for (int x = 0; x < 4; x++)
+            {
+                int sx = std::min(blockX * 4 + x, image.width - 1);
+                memcpy(block + (y * 4 + x) * 4, &image.pixels[((size_t)sy * image.width + sx) * 4], 4);
+            }
+        }
+    }
+
+    /**
+     * @brief Range-fit BC1 color block: endpoints at the extremes of the colors
+     * projected on their principal axis, always in four-color mode.
+     */
+    void encodeColorBlock(const unsigned char block[64], unsigned char out[8])
+    {
+        float mean[3] = {0, 0, 0};
+        for (int i = 0; i < 16; i++)
+            for (int c = 0; c < 3; c++)
+                mean[c] += block[i * 4 + c] / 16.0f;
+
+        float covariance[6] = {0, 0, 0, 0, 0, 0}; // xx xy xz yy yz zz
+        for (int i = 0; i < 16; i++)
+        {
+            float d[3] = {block[i * 4] - mean[0], block[i * 4 + 1] - mean[1], block[i * 4 + 2] - mean[2]};
+            covariance[0] += d[0] * d[0];
+            covariance[1] += d[0] * d[1];
+            covariance[2] += d[0] * d[2];
+            covariance[3] += d[1] * d[1];
+            covariance[4] += d[1] * d[2];
+            covariance[5] += d[2] * d[2];
+        }
+
+        // Power iteration for the principal axis
+        float axis[3] = {1.0f, 1.0f, 1.0f};
+        for (int iteration = 0; iteration < 8; iteration++)
+        {
+            float next[3] = {
+                covariance[0] * axis[0] + covariance[1] * axis[1] + covariance[2] * axis[2],
+                covariance[1] * axis[0] + covariance[3] * axis[1] + covariance[4] * axis[2],
+                covariance[2] * axis[0] + covariance[4] * axis[1] + covariance[5] * axis[2],
+            };
+            float length = std::max({std::fabs(next[0]), std::fabs(next[1]), std::fabs(next[2])});
+            if (length < 1e-6f)
+                break;
+            for (int c = 0; c < 3; c++)
+                axis[c] = next[c] / length;
+        }
+        float axisLength2 = axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2];
+
+        float minProjection = 0.0f, maxProjection = 0.0f;
+        for (int i = 0; i < 16; i++)
+        {
+            float projection = ((block[i * 4] - mean[0]) * axis[0] + (block[i * 4 + 1] - mean[1]) * axis[1] +
+                                (block[i * 4 + 2] - mean[2]) * axis[2]) / axisLength2;
+            minProjection = std::min(minProjection, projection);
+            maxProjection = std::max(maxProjection, projection);
+        }
+        float high[3], low[3];
+        for (int c = 0; c < 3; c++)
+        {
+            high[c] = mean[c] + axis[c] * maxProjection;
+            low[c] = mean[c] + axis[c] * minProjection;
+        }
+
+        uint16_t color0 = pack565(high), color1 = pack565(low);
+        if (color0 < color1)
+            std::swap(color0, color1);
+
+        uint32_t indices = 0;
+        if (color0 != color1)
+        {
+            int palette[4][3];
+            unpack565(color0, palette[0]);
+            unpack565(color1, palette[1]);
+            for (int c = 0; c < 3; c++)
+            {
+                palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+                palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+            }
+            for (int i = 0; i < 16; i++)
+            {
+                int best = 0, bestError = 1 << 30;
+                for (int p = 0; p < 4; p++)
+                {
+                    int error = 0;
+                    for (int c = 0; c < 3; c++)
+                    {
+                        int d = block[i * 4 + c] - palette[p][c];
+                        error += d * d;
+                    }
+                    if (error < bestError)
+                    {
+                        bestError = error;
+                        best = p;
+                    }
+                }
+                indices |= (uint32_t)best << (2 * i);
+            }
+        }
+
+        out[0] = color0 & 0xff;
+        out[1] = color0 >> 8;
+        out[2] = color1 & 0xff;
+        out[3] = color1 >> 8;
+        for (int b = 0; b < 4; b++)
+            out[4 + b] = (indices >> (8 * b)) & 0xff;
+    }
+
+    /**
+     * @brief BC3 alpha block in eight-value mode between the block's min and max alpha.
+     */
+    void encodeAlphaBlock(const unsigned char block[64], unsigned char out[8])
+    {
+        int alpha0 = 0, alpha1 = 255;
+        for (int i = 0; i < 16; i++)
+        {
+            alpha0 = std::max(alpha0, (int)block[i * 4 + 3]);
+            alpha1 = std::min(alpha1, (int)block[i * 4 + 3]);
+        }
+
+        uint64_t indices = 0;
+        if (alpha0 != alpha1)
+        {
+            int palette[8] = {alpha0, alpha1};
+            for (int i = 1; i < 7; i++)
+                palette[i + 1] = ((7 - i) * alpha0 + i * alpha1) / 7;
+            for (int i = 0; i < 16; i++)
+            {
+                int best = 0, bestError = 256;
+                for (int p = 0; p < 8; p++)
+                {
+                    int error = std::abs(block[i * 4 + 3] - palette[p]);
+                    if (error < bestError)
+                    {
+                        bestError = error;
+                        best = p;
+                    }
+                }
+                indices |= (uint64_t)best << (3 * i);
+            }
+        }
+
+        out[0] = (unsigned char)alpha0;
+        out[1] = (unsigned char)alpha1;
+        for (int b = 0; b < 6; b++)
+            out[2 + b] = (indices >> (8 * b)) & 0xff;
+    }
+
+    void decodeColorBlock(const unsigned char in[8], bool allowTransparent, unsigned char block[64])
+    {
+        uint16_t color0 = in[0] | (in[1] << 8), color1 = in[2] | (in[3] << 8);
+        uint32_t indices = in[4] | (in[5] << 8) | (in[6] << 16) | ((uint32_t)in[7] << 24);
+        int palette[4][4];
+        unpack565(color0, palette[0]);
+        unpack565(color1, palette[1]);
+        palette[0][3] = palette[1][3] = palette[2][3] = palette[3][3] = 255;
+        for (int c = 0; c < 3; c++)
+        {
+            if (color0 > color1 || !allowTransparent)
+            {
+                palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+                palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+            }
+            else
+            {
+                palette[2][c] = (palette[0][c] + palette[1][c]) / 2;
+                palette[3][c] = 0;
+            }
+        }
+        if (color0 <= color1 && allowTransparent)
+            palette[3][3] = 0;
+
+        for (int i = 0; i < 16; i++)
+        {
+            const int *color = palette[(indices >> (2 * i)) & 3];
+            for (int c = 0; c < 4; c++)
+                block[i * 4 + c] = (unsigned char)color[c];
+        }
+    }
+
+    void decodeAlphaBlock(const unsigned char in[8], unsigned char block[64])
+    {
+        int palette[8] = {in[0], in[1]};
+        if (palette[0] > palette[1])
+        {
+            for (int i = 1; i < 7; i++)
+                palette[i + 1] = ((7 - i) * palette[0] + i * palette[1]) / 7;
+        }
+        else
+        {
+            for (int i = 1; i < 5; i++)
+                palette[i + 1] = ((5 - i) * palette[0] + i * palette[1]) / 5;
+            palette[6] = 0;
+            palette[7] = 255;
+        }
+        uint64_t indices = 0;
+        for (int b = 0; b < 6; b++)
+            indices |= (uint64_t)in[2 + b] << (8 * b);
+        for (int i = 0; i < 16; i++)
+            block[i * 4 + 3] = (unsigned char)palette[(indices >> (3 * i)) & 7];
+    }
+}
+
+/**
+ * @brief Bytes needed for one level of the given format and size.
+ */
+size_t ctexLevelSize(CtexFormat format, int width, int height)
+{
+    size_t blocks = (size_t)((width + 3) / 4) * ((height + 3) / 4);
+    switch (format)
+    {
+    case CTEX_BC1:
+        return blocks * 8;
+    case CTEX_BC3:
+        return blocks * 16;
+    default:
+        return (size_t)width * height * 4;
+    }
+}
+
+/**
+ * @brief Builds the full mip chain down to 1x1 with a 2x2 box filter; level 0 is base itself.
+ */
+std::vector<CtexImage> ctexBuildMips(const CtexImage &base)
+{
+    std::vector<CtexImage> levels(1, base);
+    while (levels.back().width > 1 || levels.back().height > 1)
+    {
+        const CtexImage &source = levels.back();
+        CtexImage level;
+        level.width = std::max(1, source.width / 2);
+        level.height = std::max(1, source.height / 2);
+        level.pixels.resize((size_t)level.width * level.height * 4);
+        for (int y = 0; y < level.height; y++)
+        {
+            int y0 = std::min(y * 2, source.height - 1), y1 = std::min(y * 2 + 1, source.height - 1);
+            for (int x = 0; x < level.width; x++)
+            {
+                int x0 = std::min(x * 2, source.width - 1), x1 = std::min(x * 2 + 1, source.width - 1);
+                for (int c = 0; c < 4; c++)
+                {
+                    int sum = source.pixels[((size_t)y0 * source.width + x0) * 4 + c] +
+                              source.pixels[((size_t)y0 * source.width + x1) * 4 + c] +
+                              source.pixels[((size_t)y1 * source.width + x0) * 4 + c] +
+                              source.pixels[((size_t)y1 * source.width + x1) * 4 + c];
+                    level.pixels[((size_t)y * level.width + x) * 4 + c] = (unsigned char)((sum + 2) / 4);
+                }
+            }
+        }
+        levels.push_back(std::move(level));
+    }
+    return levels;
+}
+
+bool ctexHasAlpha(const CtexImage &image)
+{
+    for (size_t i = 3; i < image.pixels.size(); i += 4)
+    {
+        if (image.pixels[i] != 255)
+            return true;
+    }
+    return false;
+}
+
+/**
+ * @brief Encodes one RGBA8 level into the given format.
+ */
+std::vector<unsigned char> ctexEncode(CtexFormat format, const CtexImage &image)
+{
+    if (format == CTEX_RGBA8)
+        return image.pixels;
+
+    std::vector<unsigned char> out(ctexLevelSize(format, image.width, image.height));
+    unsigned char *cursor = out.data();
+    unsigned char block[64];
+    for (int blockY = 0; blockY < (image.height + 3) / 4; blockY++)
+    {
+        for (int blockX = 0; blockX < (image.width + 3) / 4; blockX++)
+        {
+            fetchBlock(image, blockX, blockY, block);
+            if (format == CTEX_BC3)
+            {
+                encodeAlphaBlock(block, cursor);
+                cursor += 8;
+            }
+            encodeColorBlock(block, cursor);
+            cursor += 8;
+        }
+    }
+    return out;
+}
+
+/**
+ * @brief Decodes one level back to RGBA8, for drivers without support for the block format.
+ */
+CtexImage ctexDecode(CtexFormat format, int width, int height, const unsigned char *data)
+{
+    CtexImage image;
+    image.width = width;
+    image.height = height;
+    if (format == CTEX_RGBA8)
+    {
+        image.pixels.assign(data, data + (size_t)width * height * 4);
+        return image;
+    }
+
+    image.pixels.resize((size_t)width * height * 4);
+    unsigned char block[64];
+    for (int blockY = 0; blockY < (height + 3) / 4; blockY++)
+    {
+        for (int blockX = 0; blockX < (width + 3) / 4; blockX++)
+        {
+            if (format == CTEX_BC3)
+            {
+                decodeColorBlock(data + 8, false, block);
+                decodeAlphaBlock(data, block);
+                data += 16;
+            }
+            else
+            {
+                decodeColorBlock(data, true, block);
+                data += 8;
+            }
+            for (int y = 0; y < 4 && blockY * 4 + y < height; y++)
+            {
+                for (int x = 0; x < 4 && blockX * 4 + x < width; x++)
+                {
+                    memcpy(&image.pixels[((size_t)(blockY * 4 + y) * width + blockX * 4 + x) * 4], block + (y * 4 + x) * 4, 4);
+                }
+            }
+        }
+    }
+    return image;
+}
+
+/**
+ * @brief Encodes the levels and writes them as a .ctex file.
+ */
+bool ctexWrite(const std::string &path, CtexFormat format, const std::vector<CtexImage> &levels)
+{
+    CtexHeader header = {{'C', 'T', 'E', 'X'}, ctexVersion, format,
+                         (uint32_t)levels[0].width, (uint32_t)levels[0].height, (uint32_t)levels.size(), {0, 0}};
+    std::vector<CtexLevel> table(levels.size());
+    std::vector<std::vector<unsigned char>> encoded(levels.size());
+
+    size_t offset = sizeof(CtexHeader) + sizeof(CtexLevel) * levels.size();
+    for (size_t i = 0; i < levels.size(); i++)
+    {
+        offset = (offset + levelAlignment - 1) / levelAlignment * levelAlignment;
+        encoded[i] = ctexEncode(format, levels[i]);
+        table[i] = {(uint32_t)offset, (uint32_t)encoded[i].size(), (uint32_t)levels[i].width, (uint32_t)levels[i].height};
+        offset += encoded[i].size();
+    }
+
+    FILE *file = fopen(path.c_str(), "wb");
+    if (!file)
+    {
+        fprintf(stderr, "Cannot write %s\n", path.c_str());
+        return false;
+    }
+    fwrite(&header, sizeof(header), 1, file);
+    fwrite(table.data(), sizeof(CtexLevel), table.size(), file);
+    const unsigned char padding[levelAlignment] = {};
+    for (size_t i = 0; i < levels.size(); i++)
+    {
+        long position = ftell(file);
+        fwrite(padding, 1, table[i].offset - position, file);
+        fwrite(encoded[i].data(), 1, encoded[i].size(), file);
+    }
+    bool ok = ferror(file) == 0;
+    fclose(file);
+    return ok;
+}
+
+/**
+ * @brief Where texcook puts the cooked version of a source image: <directory>/<path>.ctex.
+ *
+ * The whole source path is kept, so a/fire.png and b/fire.png don't share a
+ * cooked file. It is lexically normalized, with the root and any leading ../
+ * dropped, so "../texture/Fire.jpg" opened from build/ and "texture/Fire.jpg"
+ * cooked from the source tree both map to <directory>/texture/Fire.jpg.ctex.
+ */
+std::string cookedTexturePath(const std::string &directory, const std::string &sourcePath)
+{
+    std::filesystem::path relative;
+    for (const std::filesystem::path &part : std::filesystem::path(sourcePath).lexically_normal().relative_path())
+    {
+        if (!(relative.empty() && part == ".."))
+            relative /= part;
+    }
+    return directory + "/" + relative.generic_string() + ".ctex";
+}
+
+/**
+ * @brief Maps the file, from the asset pack when it has it, and validates its header and level table.
+ */
+bool CtexFile::open(const std::string &path)
+{
+    if (!readAsset(path, asset))
+        return false;
+    data = asset.data();
+    size = asset.size();
+
+    bool valid = size >= sizeof(CtexHeader);
+    if (valid)
+    {
+        const CtexHeader &head = header();
+        valid = memcmp(head.magic, "CTEX", 4) == 0 && head.version == ctexVersion && head.format <= CTEX_BC3 &&
+                head.levels >= 1 && head.levels <= 32 && size >= sizeof(CtexHeader) + sizeof(CtexLevel) * head.levels;
+    }
+    for (unsigned int i = 0; valid && i < header().levels; i++)
+    {
+        const CtexLevel &entry = level(i);
+        valid = (size_t)entry.offset + entry.size <= size &&
+                entry.size == ctexLevelSize((CtexFormat)header().format, entry.width, entry.height);
+    }
+    if (!valid)
+    {
+        fprintf(stderr, "%s is not a valid .ctex file\n", path.c_str());
+        asset = Asset();
+        data = nullptr;
+        size = 0;
+    }
+    return valid;
+}
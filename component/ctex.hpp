@@ -0,0 +1,86 @@
+#ifndef CTEX_HPP
+#define CTEX_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "assetpack.hpp"
+
+/**
+ * @brief Cooked texture container (.ctex): a header, a level table, then each
+ * mip level's data, 16-byte aligned, largest level first.
+ *
+ * Rows are stored bottom-up, as GL expects, so levels can be uploaded straight
+ * from the mapped file. Block formats store 4x4 blocks in row-major block order.
+ */
+enum CtexFormat : uint32_t
+{
+    CTEX_RGBA8 = 0,
+    CTEX_BC1 = 1, // 8 bytes per 4x4 block, opaque RGB
+    CTEX_BC3 = 2, // 16 bytes per 4x4 block, RGB + interpolated alpha
+};
+
+struct CtexHeader
+{
+    char magic[4]; // "CTEX"
+    uint32_t version;
+    uint32_t format;
+    uint32_t width;
+    uint32_t height;
+    uint32_t levels;
+    uint32_t reserved[2];
+};
+
+struct CtexLevel
+{
+    uint32_t offset; // From the start of the file
+    uint32_t size;
+    uint32_t width;
+    uint32_t height;
+};
+
+/**
+ * @brief One mip level of an RGBA8 image, bottom row first.
+ */
+struct CtexImage
+{
+    int width;
+    int height;
+    std::vector<unsigned char> pixels;
+};
+
+const uint32_t ctexVersion = 1;
+
+size_t ctexLevelSize(CtexFormat format, int width, int height);
+std::vector<CtexImage> ctexBuildMips(const CtexImage &base);
+bool ctexHasAlpha(const CtexImage &image);
+std::vector<unsigned char> ctexEncode(CtexFormat format, const CtexImage &image);
+CtexImage ctexDecode(CtexFormat format, int width, int height, const unsigned char *data);
+bool ctexWrite(const std::string &path, CtexFormat format, const std::vector<CtexImage> &levels);
+std::string cookedTexturePath(const std::string &directory, const std::string &sourcePath);
+
+/**
+ * @brief Read-only view of a .ctex file, read zero-copy through readAsset().
+ */
+class CtexFile
+{
+public:
+    CtexFile() : data(nullptr), size(0) {}
+
+    CtexFile(const CtexFile &) = delete;
+    CtexFile &operator=(const CtexFile &) = delete;
+
+    bool open(const std::string &path);
+
+    const CtexHeader &header() const { return *(const CtexHeader *)data; }
+    const CtexLevel &level(unsigned int index) const { return ((const CtexLevel *)(data + sizeof(CtexHeader)))[index]; }
+    const unsigned char *levelData(unsigned int index) const { return data + level(index).offset; }
+
+private:
+    Asset asset;
+    const unsigned char *data;
+    size_t size;
+};
+
+#endif
@@ -0,0 +1,108 @@
+#include "curlnoise.hpp"
+#include "threadpool.hpp"
+#include "profiler.hpp"
+
+#include <stdio.h>
+
+namespace
+{
+    float hash(int x, int y, int z, unsigned int seed)
+    {
+        unsigned int h = (unsigned int)x * 374761393u + (unsigned int)y * 668265263u + (unsigned int)z * 2147483647u + seed * 2246822519u;
+        h = (h ^ (h >> 13)) * 1274126177u;
+        return (h ^ (h >> 16)) / 2147483647.5f - 1.0f;
+    }
+
+    /**
+     * @brief Value noise in [-1, 1] whose lattice repeats every period cells on each axis.
+     */
+    float periodicNoise(float x, float y, float z, int period, unsigned int seed)
+    {
+        int ix = (int)std::floor(x), iy = (int)std::floor(y), iz = (int)std::floor(z);
+        float fx = x - ix, fy = y - iy, fz = z - iz;
+        fx = fx * fx * (3.0f - 2.0f * fx);
+        fy = fy * fy * (3.0f - 2.0f * fy);
+        fz = fz * fz * (3.0f - 2.0f * fz);
+        auto at = [&](int dx, int dy, int dz) {
+            return hash((ix + dx) % period, (iy + dy) % period, (iz + dz) % period, seed);
+        };
+        float x00 = at(0, 0, 0) + (at(1, 0, 0) - at(0, 0, 0)) * fx;
+        float x10 = at(0, 1, 0) + (at(1, 1, 0) - at(0, 1, 0)) * fx;
+        float x01 = at(0, 0, 1) + (at(1, 0, 1) - at(0, 0, 1)) * fx;
+        float x11 = at(0, 1, 1) + (at(1, 1, 1) - at(0, 1, 1)) * fx;
+        float y0 = x00 + (x10 - x00) * fy;
+        float y1 = x01 + (x11 - x01) * fy;
+        return y0 + (y1 - y0) * fz;
+    }
+}
+
+/**
+ * @brief Bakes the field.
+ *
+ * @param size Cells per side; rounded up to a power of two so sampling can wrap with a mask.
+ * @param seed Picks the noise pattern.
+ */
+CurlNoiseField::CurlNoiseField(int size, unsigned int seed) : edge(1)
+{
+    PROFILE_SCOPE("bake curl noise");
+    while (edge < size)
+        edge *= 2;
+    size_t count = (size_t)edge * edge * edge;
+
+    // Vector potential: three octaves of periodic noise per component, coarsest lattice 4 cells across the tile
+    std::vector<glm::vec3> potential(count);
+    ThreadPool::shared().parallelFor(0, edge, 1, [&](size_t begin, size_t end) {
+        for (size_t z = begin; z < end; z++)
+            for (int y = 0; y < edge; y++)
+                for (int x = 0; x < edge; x++)
+                {
+                    glm::vec3 value(0.0f);
+                    float amplitude = 1.0f;
+                    for (int period = 4; period <= 16 && period <= edge; period *= 2, amplitude *= 0.5f)
+                    {
+                        float scale = (float)period / edge;
+                        for (int c = 0; c < 3; c++)
+                            value[c] += amplitude * periodicNoise(x * scale, y * scale, z * scale, period, seed * 3 + c);
+                    }
+                    potential[((size_t)z * edge + y) * edge + x] = value;
+                }
+    });
+
+    // Curl by central differences with wrap-around, which keeps the result periodic and divergence-free
+    cells.assign(count * 4, 0.0f);
+    int mask = edge - 1;
+    auto at = [&](int x, int y, int z) -> const glm::vec3 & {
+        return potential[(((size_t)(z & mask)) * edge + (y & mask)) * edge + (x & mask)];
+    };
+    ThreadPool::shared().parallelFor(0, edge, 1, [&](size_t begin, size_t end) {
+        for (int z = (int)begin; z < (int)end; z++)
+            for (int y = 0; y < edge; y++)
+                for (int x = 0; x < edge; x++)
+                {
+                    glm::vec3 dx = (at(x + 1, y, z) - at(x - 1, y, z)) * 0.5f;
+                    glm::vec3 dy = (at(x, y + 1, z) - at(x, y - 1, z)) * 0.5f;
+                    glm::vec3 dz = (at(x, y, z + 1) - at(x, y, z - 1)) * 0.5f;
+                    float *out = &cells[(((size_t)z * edge + y) * edge + x) * 4];
+                    out[0] = dy.z - dz.y;
+                    out[1] = dz.x - dx.z;
+                    out[2] = dx.y - dy.x;
+                }
+    });
+
+    double sum = 0.0;
+    for (size_t i = 0; i < count; i++)
+        sum += cells[i * 4] * cells[i * 4] + cells[i * 4 + 1] * cells[i * 4 + 1] + cells[i * 4 + 2] * cells[i * 4 + 2];
+    float scale = sum > 0.0 ? (float)(1.0 / std::sqrt(sum / count)) : 1.0f;
+    for (float &value : cells)
+        value *= scale;
+    printf("Curl noise field: %d^3 cells, %.1f KiB\n", edge, cells.size() * sizeof(float) / 1024.0);
+}
+
+/**
+ * @brief A 32^3 field built on first use and shared by every turbulence module that doesn't bring its own.
+ */
+std::shared_ptr<const CurlNoiseField> CurlNoiseField::shared()
+{
+    static std::shared_ptr<const CurlNoiseField> field = std::make_shared<const CurlNoiseField>(32, 1);
+    return field;
+}
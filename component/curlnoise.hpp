@@ -0,0 +1,79 @@
+#ifndef CURLNOISE_HPP
+#define CURLNOISE_HPP
+
+#include <cmath>
+#include <memory>
+#include <vector>
+#include <glm/glm.hpp>
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#include <xmmintrin.h>
+#define CURLNOISE_SSE 1
+#endif
+
+/**
+ * @brief A tileable, divergence-free velocity field baked into a periodic 3D grid.
+ *
+ * The field is the curl of a vector potential built from three octaves of
+ * periodic value noise, so it swirls without sources or sinks and wraps
+ * seamlessly in every direction. Baking happens once, spread over the thread
+ * pool; sample() is then a trilinear blend of eight grid cells, done four
+ * lanes at a time where SSE is available. Values are scaled to unit RMS
+ * magnitude.
+ */
+class CurlNoiseField
+{
+public:
+    CurlNoiseField(int size, unsigned int seed);
+
+    static std::shared_ptr<const CurlNoiseField> shared();
+
+    int size() const { return edge; }
+
+    /**
+     * @brief Field value at a point given in tiles; the field repeats every 1 unit.
+     */
+    glm::vec3 sample(const glm::vec3 &point) const
+    {
+        float x = point.x * edge, y = point.y * edge, z = point.z * edge;
+        float fx = std::floor(x), fy = std::floor(y), fz = std::floor(z);
+        float tx = x - fx, ty = y - fy, tz = z - fz;
+        int mask = edge - 1;
+        int x0 = (int)fx & mask, y0 = (int)fy & mask, z0 = (int)fz & mask;
+        int x1 = (x0 + 1) & mask, y1 = (y0 + 1) & mask, z1 = (z0 + 1) & mask;
+        const float *c000 = cell(x0, y0, z0), *c100 = cell(x1, y0, z0), *c010 = cell(x0, y1, z0), *c110 = cell(x1, y1, z0);
+        const float *c001 = cell(x0, y0, z1), *c101 = cell(x1, y0, z1), *c011 = cell(x0, y1, z1), *c111 = cell(x1, y1, z1);
+#ifdef CURLNOISE_SSE
+        __m128 wx = _mm_set1_ps(tx), wy = _mm_set1_ps(ty), wz = _mm_set1_ps(tz);
+        auto lerp = [](__m128 a, __m128 b, __m128 t) { return _mm_add_ps(a, _mm_mul_ps(_mm_sub_ps(b, a), t)); };
+        __m128 a = lerp(_mm_loadu_ps(c000), _mm_loadu_ps(c100), wx);
+        __m128 b = lerp(_mm_loadu_ps(c010), _mm_loadu_ps(c110), wx);
+        __m128 c = lerp(_mm_loadu_ps(c001), _mm_loadu_ps(c101), wx);
+        __m128 d = lerp(_mm_loadu_ps(c011), _mm_loadu_ps(c111), wx);
+        __m128 value = lerp(lerp(a, b, wy), lerp(c, d, wy), wz);
+        float result[4];
+        _mm_storeu_ps(result, value);
+        return glm::vec3(result[0], result[1], result[2]);
+#else
+        glm::vec3 result;
+        for (int i = 0; i < 3; i++)
+        {
+            float a = c000[i] + (c100[i] - c000[i]) * tx;
+            float b = c010[i] + (c110[i] - c010[i]) * tx;
+            float c = c001[i] + (c101[i] - c001[i]) * tx;
+            float d = c011[i] + (c111[i] - c011[i]) * tx;
+            float e = a + (b - a) * ty;
+            result[i] = e + (c + (d - c) * ty - e) * tz;
+        }
+        return result;
+#endif
+    }
+
+private:
+    const float *cell(int x, int y, int z) const { return &cells[(((size_t)z * edge + y) * edge + x) * 4]; }
+
+    int edge;                 // Cells per side, a power of two
+    std::vector<float> cells; // xyz plus one padding float per cell, so a cell is one 16-byte load
+};
+
+#endif
@@ -0,0 +1,425 @@
+#include "distancefield.hpp"
+#include "threadpool.hpp"
+#include "profiler.hpp"
+
+#include <stdio.h>
+#include <cfloat>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <sstream>
+#include <unordered_map>
+
+namespace
+{
+    const size_t dataAlignment = 16;
+
+    enum TriangleRegion
+    {
+        REGION_FACE,
+        REGION_VERTEX, // + vertex index
+        REGION_EDGE = REGION_VERTEX + 3, // + index of the edge's first vertex
+    };
+
+    /**
+     * @brief A triangle with the angle-weighted pseudonormals of its face, edges and vertices.
+     *
+     * The sign of the distance is the side of the pseudonormal of whichever
+     * feature the closest point lies on, which stays correct at edges and
+     * corners where the face normal alone would not.
+     */
+    struct BakeTriangle
+    {
+        glm::vec3 corner[3];
+        glm::vec3 normal[7]; // Indexed by TriangleRegion
+    };
+
+    /**
+     * @brief Closest point on a triangle, after Ericson's Real-Time Collision Detection.
+     */
+    glm::vec3 closestPoint(const glm::vec3 &p, const glm::vec3 &a, const glm::vec3 &b, const glm::vec3 &c, int &region)
+    {
+        glm::vec3 ab = b - a, ac = c - a, ap = p - a;
+        float d1 = glm::dot(ab, ap), d2 = glm::dot(ac, ap);
+        if (d1 <= 0.0f && d2 <= 0.0f)
+        {
+            region = REGION_VERTEX + 0;
+            return a;
+        }
+        glm::vec3 bp = p - b;
+        float d3 = glm::dot(ab, bp), d4 = glm::dot(ac, bp);
+        if (d3 >= 0.0f && d4 <= d3)
+        {
+            region = REGION_VERTEX + 1;
+            return b;
+        }
+        float vc = d1 * d4 - d3 * d2;
+        if (vc <= 0.0f && d1 >= 0.0f && d3 <= 0.0f)
+        {
+            region = REGION_EDGE + 0;
+            return a + ab * (d1 / (d1 - d3));
+        }
+        glm::vec3 cp = p - c;
+        float d5 = glm::dot(ab, cp), d6 = glm::dot(ac, cp);
+        if (d6 >= 0.0f && d5 <= d6)
+        {
+            region = REGION_VERTEX + 2;
+            return c;
+        }
+        float vb = d5 * d2 - d1 * d6;
+        if (vb <= 0.0f && d2 >= 0.0f && d6 <= 0.0f)
+        {
+            region = REGION_EDGE + 2;
+            return a + ac * (d2 / (d2 - d6));
+        }
+        float va = d3 * d6 - d5 * d4;
+        if (va <= 0.0f && (d4 - d3) >= 0.0f && (d5 - d6) >= 0.0f)
+        {
+            region = REGION_EDGE + 1;
+            return b + (c - b) * ((d4 - d3) / ((d4 - d3) + (d5 - d6)));
+        }
+        float denominator = 1.0f / (va + vb + vc);
+        region = REGION_FACE;
+        return a + ab * (vb * denominator) + ac * (vc * denominator);
+    }
+
+    std::vector<BakeTriangle> buildTriangles(const TriangleMesh &mesh)
+    {
+        size_t count = mesh.indices.size() / 3;
+        std::vector<glm::vec3> vertexNormals(mesh.vertices.size(), glm::vec3(0.0f));
+        std::unordered_map<uint64_t, glm::vec3> edgeNormals;
+        auto edgeKey = [](uint32_t a, uint32_t b) { return a < b ? (uint64_t)a << 32 | b : (uint64_t)b << 32 | a; };
+
+        std::vector<BakeTriangle> triangles(count);
+        for (size_t t = 0; t < count; t++)
+        {
+            const uint32_t *index = &mesh.indices[t * 3];
+            BakeTriangle &triangle = triangles[t];
+            for (int i = 0; i < 3; i++)
+                triangle.corner[i] = mesh.vertices[index[i]];
+            glm::vec3 cross = glm::cross(triangle.corner[1] - triangle.corner[0], triangle.corner[2] - triangle.corner[0]);
+            float area = std::sqrt(glm::dot(cross, cross));
+            glm::vec3 normal = area > 0.0f ? cross / area : glm::vec3(0.0f);
+            triangle.normal[REGION_FACE] = normal;
+            for (int i = 0; i < 3; i++)
+            {
+                glm::vec3 e0 = triangle.corner[(i + 1) % 3] - triangle.corner[i];
+                glm::vec3 e1 = triangle.corner[(i + 2) % 3] - triangle.corner[i];
+                float lengths = std::sqrt(glm::dot(e0, e0) * glm::dot(e1, e1));
+                float angle = lengths > 0.0f ? std::acos(glm::clamp(glm::dot(e0, e1) / lengths, -1.0f, 1.0f)) : 0.0f;
+                vertexNormals[index[i]] += normal * angle;
+                edgeNormals[edgeKey(index[i], index[(i + 1) % 3])] += normal;
+            }
+        }
+        for (size_t t = 0; t < count; t++)
+        {
+            const uint32_t *index = &mesh.indices[t * 3];
+            for (int i = 0; i < 3; i++)
+            {
+                triangles[t].normal[REGION_VERTEX + i] = vertexNormals[index[i]];
+                triangles[t].normal[REGION_EDGE + i] = edgeNormals[edgeKey(index[i], index[(i + 1) % 3])];
+            }
+        }
+        return triangles;
+    }
+}
+
+/**
+ * @brief Reads the positions and faces of a Wavefront OBJ file. Polygons are split into fans.
+ */
+bool loadObj(const std::string &path, TriangleMesh &mesh)
+{
+    std::ifstream file(path);
+    if (!file)
+    {
+        fprintf(stderr, "Cannot open %s\n", path.c_str());
+        return false;
+    }
+    mesh = TriangleMesh();
+    std::string line;
+    std::vector<uint32_t> face;
+    while (std::getline(file, line))
+    {
+        std::istringstream stream(line);
+        std::string keyword;
+        stream >> keyword;
+        if (keyword == "v")
+        {
+            glm::vec3 position;
+            stream >> position.x >> position.y >> position.z;
+            mesh.vertices.push_back(position);
+        }
+        else if (keyword == "f")
+        {
+            face.clear();
+            std::string corner;
+            while (stream >> corner)
+            {
+                // v, v/vt, v//vn or v/vt/vn; negative indices count back from the last vertex
+                long index = std::strtol(corner.c_str(), nullptr, 10);
+                if (index < 0)
+                    index += (long)mesh.vertices.size() + 1;
+                if (index < 1 || index > (long)mesh.vertices.size())
+                {
+                    fprintf(stderr, "%s: bad vertex index in \"%s\"\n", path.c_str(), line.c_str());
+                    return false;
+                }
+                face.push_back((uint32_t)index - 1);
+            }
+            for (size_t i = 2; i < face.size(); i++)
+            {
+                mesh.indices.push_back(face[0]);
+                mesh.indices.push_back(face[i - 1]);
+                mesh.indices.push_back(face[i]);
+            }
+        }
+    }
+    if (mesh.indices.empty())
+    {
+        fprintf(stderr, "%s has no faces\n", path.c_str());
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Bakes a closed triangle mesh into a narrow-band .csdf file.
+ *
+ * Triangles are binned into the bricks within the band of them, and the
+ * bricks holding triangles are evaluated in parallel on the thread pool,
+ * each sample against only its brick's triangles. Bricks whose samples all end
+ * up beyond the band are dropped. Dropped bricks and bricks without triangles
+ * take their sign from a flood fill over the brick grid, seeded from the border
+ * of the grid, which lies outside the mesh; regions the fill can't reach take
+ * the sign of one exact query against all the triangles. A dropped brick's own
+ * samples only saw its binned triangles, so their sign isn't trusted.
+ *
+ * @param voxelSize Sample spacing in mesh units.
+ * @param bandCells Half-width of the stored band, in samples.
+ */
+bool bakeDistanceField(const TriangleMesh &mesh, float voxelSize, float bandCells, const std::string &path)
+{
+    PROFILE_SCOPE("bake distance field");
+    std::vector<BakeTriangle> triangles = buildTriangles(mesh);
+    float band = bandCells * voxelSize;
+
+    glm::vec3 meshMin(FLT_MAX), meshMax(-FLT_MAX);
+    for (const glm::vec3 &vertex : mesh.vertices)
+    {
+        meshMin = glm::min(meshMin, vertex);
+        meshMax = glm::max(meshMax, vertex);
+    }
+    glm::vec3 origin = meshMin - glm::vec3(band + voxelSize);
+    glm::vec3 extent = meshMax + glm::vec3(band + voxelSize) - origin;
+    int bricks[3];
+    for (int axis = 0; axis < 3; axis++)
+        bricks[axis] = std::max(1, (int)std::ceil(extent[axis] / voxelSize / sdfBrickCells));
+    size_t brickTotal = (size_t)bricks[0] * bricks[1] * bricks[2];
+    auto brickIndex = [&](int x, int y, int z) { return ((size_t)z * bricks[1] + y) * bricks[0] + x; };
+
+    // A brick covers samples b * 7 to b * 7 + 7, so a triangle matters to it if its padded box reaches that span
+    std::vector<std::vector<uint32_t>> bins(brickTotal);
+    for (size_t t = 0; t < triangles.size(); t++)
+    {
+        const BakeTriangle &triangle = triangles[t];
+        glm::vec3 low = (glm::min(glm::min(triangle.corner[0], triangle.corner[1]), triangle.corner[2]) - glm::vec3(band) - origin) / voxelSize;
+        glm::vec3 high = (glm::max(glm::max(triangle.corner[0], triangle.corner[1]), triangle.corner[2]) + glm::vec3(band) - origin) / voxelSize;
+        int first[3], last[3];
+        for (int axis = 0; axis < 3; axis++)
+        {
+            first[axis] = std::max(0, (int)std::ceil(low[axis] / sdfBrickCells - 1.0f));
+            last[axis] = std::min(bricks[axis] - 1, (int)std::floor(high[axis] / sdfBrickCells));
+        }
+        for (int z = first[2]; z <= last[2]; z++)
+            for (int y = first[1]; y <= last[1]; y++)
+                for (int x = first[0]; x <= last[0]; x++)
+                    bins[brickIndex(x, y, z)].push_back((uint32_t)t);
+    }
+
+    std::vector<size_t> narrow;
+    for (size_t i = 0; i < brickTotal; i++)
+        if (!bins[i].empty())
+            narrow.push_back(i);
+
+    const size_t brickValues = sdfBrickSamples * sdfBrickSamples * sdfBrickSamples;
+    std::vector<int16_t> values(narrow.size() * brickValues);
+    std::vector<char> dropped(narrow.size(), 0); // Bricks entirely beyond the band
+    ThreadPool::shared().parallelFor(0, narrow.size(), 1, [&](size_t begin, size_t end) {
+        for (size_t n = begin; n < end; n++)
+        {
+            size_t brick = narrow[n];
+            int bx = (int)(brick % bricks[0]), by = (int)(brick / bricks[0] % bricks[1]), bz = (int)(brick / bricks[0] / bricks[1]);
+            const std::vector<uint32_t> &bin = bins[brick];
+            int16_t *out = &values[n * brickValues];
+            bool inBand = false;
+            for (int z = 0; z < sdfBrickSamples; z++)
+                for (int y = 0; y < sdfBrickSamples; y++)
+                    for (int x = 0; x < sdfBrickSamples; x++)
+                    {
+                        glm::vec3 p = origin + glm::vec3((float)(bx * sdfBrickCells + x), (float)(by * sdfBrickCells + y),
+                                                         (float)(bz * sdfBrickCells + z)) * voxelSize;
+                        float best = FLT_MAX;
+                        glm::vec3 bestPoint(0.0f), bestNormal(0.0f);
+                        for (uint32_t t : bin)
+                        {
+                            const BakeTriangle &triangle = triangles[t];
+                            int region;
+                            glm::vec3 q = closestPoint(p, triangle.corner[0], triangle.corner[1], triangle.corner[2], region);
+                            glm::vec3 d = p - q;
+                            float distance2 = glm::dot(d, d);
+                            if (distance2 < best)
+                            {
+                                best = distance2;
+                                bestPoint = q;
+                                bestNormal = triangle.normal[region];
+                            }
+                        }
+                        float distance = std::min(std::sqrt(best), band);
+                        if (glm::dot(p - bestPoint, bestNormal) < 0.0f)
+                            distance = -distance;
+                        inBand = inBand || std::fabs(distance) < band;
+                        out[(z * sdfBrickSamples + y) * sdfBrickSamples + x] = (int16_t)std::lround(distance / band * 32767.0f);
+                    }
+            dropped[n] = !inBand;
+        }
+    });
+
+    // Flood the sign through the bricks without surface; a brick with surface separates inside from outside
+    const uint32_t unknown = 0xFFFFFFFDu;
+    std::vector<uint32_t> table(brickTotal, unknown);
+    std::deque<size_t> queue;
+    uint32_t stored = 0;
+    for (size_t n = 0; n < narrow.size(); n++)
+    {
+        if (dropped[n])
+            continue;
+        if (stored != n)
+            memcpy(&values[stored * brickValues], &values[n * brickValues], brickValues * sizeof(int16_t));
+        table[narrow[n]] = stored++;
+    }
+    values.resize(stored * brickValues);
+    for (int z = 0; z < bricks[2]; z++)
+        for (int y = 0; y < bricks[1]; y++)
+            for (int x = 0; x < bricks[0]; x++)
+            {
+                size_t i = brickIndex(x, y, z);
+                bool border = x == 0 || y == 0 || z == 0 || x == bricks[0] - 1 || y == bricks[1] - 1 || z == bricks[2] - 1;
+                if (border && table[i] == unknown)
+                {
+                    table[i] = sdfBrickOutside;
+                    queue.push_back(i);
+                }
+            }
+    auto flood = [&]() {
+        while (!queue.empty())
+        {
+            size_t i = queue.front();
+            queue.pop_front();
+            int x = (int)(i % bricks[0]), y = (int)(i / bricks[0] % bricks[1]), z = (int)(i / bricks[0] / bricks[1]);
+            const int offsets[6][3] = {{-1, 0, 0}, {1, 0, 0}, {0, -1, 0}, {0, 1, 0}, {0, 0, -1}, {0, 0, 1}};
+            for (const int *offset : offsets)
+            {
+                int nx = x + offset[0], ny = y + offset[1], nz = z + offset[2];
+                if (nx < 0 || ny < 0 || nz < 0 || nx >= bricks[0] || ny >= bricks[1] || nz >= bricks[2])
+                    continue;
+                size_t j = brickIndex(nx, ny, nz);
+                if (table[j] == unknown)
+                {
+                    table[j] = table[i];
+                    queue.push_back(j);
+                }
+            }
+        }
+    };
+    flood();
+    // Regions walled in by surface bricks, such as the inside of the mesh, take the sign of one exact query
+    for (size_t i = 0; i < brickTotal; i++)
+    {
+        if (table[i] != unknown)
+            continue;
+        int x = (int)(i % bricks[0]), y = (int)(i / bricks[0] % bricks[1]), z = (int)(i / bricks[0] / bricks[1]);
+        glm::vec3 p = origin + (glm::vec3((float)x, (float)y, (float)z) + 0.5f) * (float)sdfBrickCells * voxelSize;
+        float best = FLT_MAX;
+        glm::vec3 bestPoint(0.0f), bestNormal(0.0f);
+        for (const BakeTriangle &triangle : triangles)
+        {
+            int region;
+            glm::vec3 q = closestPoint(p, triangle.corner[0], triangle.corner[1], triangle.corner[2], region);
+            float distance2 = glm::dot(p - q, p - q);
+            if (distance2 < best)
+            {
+                best = distance2;
+                bestPoint = q;
+                bestNormal = triangle.normal[region];
+            }
+        }
+        table[i] = glm::dot(p - bestPoint, bestNormal) < 0.0f ? sdfBrickInside : sdfBrickOutside;
+        queue.push_back(i);
+        flood();
+    }
+
+    SdfHeader header = {{'C', 'S', 'D', 'F'}, sdfVersion, {origin.x, origin.y, origin.z}, voxelSize, band,
+                        {(uint32_t)bricks[0], (uint32_t)bricks[1], (uint32_t)bricks[2]}, stored, 0};
+    size_t dataOffset = sizeof(SdfHeader) + table.size() * sizeof(uint32_t);
+    dataOffset = (dataOffset + dataAlignment - 1) / dataAlignment * dataAlignment;
+    header.dataOffset = (uint32_t)dataOffset;
+
+    FILE *file = fopen(path.c_str(), "wb");
+    if (!file)
+    {
+        fprintf(stderr, "Cannot write %s\n", path.c_str());
+        return false;
+    }
+    fwrite(&header, sizeof(header), 1, file);
+    fwrite(table.data(), sizeof(uint32_t), table.size(), file);
+    const unsigned char padding[dataAlignment] = {};
+    fwrite(padding, 1, dataOffset - ftell(file), file);
+    fwrite(values.data(), sizeof(int16_t), values.size(), file);
+    bool ok = ferror(file) == 0;
+    fclose(file);
+
+    size_t dense = brickTotal * brickValues * sizeof(int16_t);
+    printf("%zu triangles -> %s: %dx%dx%d bricks, %u stored (%.1f%%), %.1f KiB (%.1fx smaller than dense)\n",
+           triangles.size(), path.c_str(), bricks[0], bricks[1], bricks[2], stored, 100.0 * stored / brickTotal,
+           (dataOffset + values.size() * sizeof(int16_t)) / 1024.0,
+           (double)dense / (dataOffset + values.size() * sizeof(int16_t)));
+    return ok;
+}
+
+bool DistanceField::open(const std::string &path)
+{
+    if (!readAsset(path, asset))
+        return false;
+    const unsigned char *data = asset.data();
+    size_t size = asset.size();
+
+    bool valid = size >= sizeof(SdfHeader);
+    if (valid)
+    {
+        const SdfHeader *candidate = (const SdfHeader *)data;
+        size_t bricks = (size_t)candidate->bricks[0] * candidate->bricks[1] * candidate->bricks[2];
+        size_t brickValues = sdfBrickSamples * sdfBrickSamples * sdfBrickSamples;
+        valid = memcmp(candidate->magic, "CSDF", 4) == 0 && candidate->version == sdfVersion && bricks > 0 &&
+                candidate->voxelSize > 0.0f && candidate->band > 0.0f &&
+                candidate->dataOffset >= sizeof(SdfHeader) + bricks * sizeof(uint32_t) &&
+                candidate->dataOffset % dataAlignment == 0 &&
+                size >= candidate->dataOffset + candidate->brickCount * brickValues * sizeof(int16_t);
+        for (size_t i = 0; valid && i < bricks; i++)
+        {
+            uint32_t index = ((const uint32_t *)(data + sizeof(SdfHeader)))[i];
+            valid = index < candidate->brickCount || index == sdfBrickOutside || index == sdfBrickInside;
+        }
+    }
+    if (!valid)
+    {
+        fprintf(stderr, "%s is not a valid .csdf file\n", path.c_str());
+        asset = Asset();
+        return false;
+    }
+    head = (const SdfHeader *)data;
+    table = (const uint32_t *)(data + sizeof(SdfHeader));
+    values = (const int16_t *)(data + head->dataOffset);
+    return true;
+}
@@ -0,0 +1,133 @@
+#ifndef DISTANCEFIELD_HPP
+#define DISTANCEFIELD_HPP
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <glm/glm.hpp>
+#include "assetpack.hpp"
+
+/**
+ * @brief Baked signed distance field (.csdf): a header, a brick table, then
+ * the stored bricks, 16-byte aligned.
+ *
+ * The grid is split into bricks of 8^3 samples covering 7^3 cells; neighbouring
+ * bricks repeat their shared face so a trilinear lookup never leaves its brick.
+ * Only bricks within the narrow band around the surface are stored, as int16
+ * distances scaled to the band. The table holds each brick's index in the brick
+ * data, or one of the sentinels for bricks entirely outside or inside it.
+ * Distances are negative inside the mesh.
+ */
+const int sdfBrickSamples = 8;
+const int sdfBrickCells = sdfBrickSamples - 1;
+const uint32_t sdfBrickOutside = 0xFFFFFFFFu;
+const uint32_t sdfBrickInside = 0xFFFFFFFEu;
+const uint32_t sdfVersion = 1;
+
+struct SdfHeader
+{
+    char magic[4]; // "CSDF"
+    uint32_t version;
+    float origin[3]; // Position of the first sample
+    float voxelSize;
+    float band; // Distances are clamped to +-band, in world units
+    uint32_t bricks[3];
+    uint32_t brickCount; // Stored bricks
+    uint32_t dataOffset; // From the start of the file
+};
+
+/**
+ * @brief Triangle soup with shared vertices, as read from an OBJ file.
+ */
+struct TriangleMesh
+{
+    std::vector<glm::vec3> vertices;
+    std::vector<uint32_t> indices; // Three per triangle
+};
+
+bool loadObj(const std::string &path, TriangleMesh &mesh);
+bool bakeDistanceField(const TriangleMesh &mesh, float voxelSize, float bandCells, const std::string &path);
+
+/**
+ * @brief Read-only view of a .csdf file, read zero-copy through readAsset().
+ *
+ * sample() costs one table lookup and one trilinear blend, however many
+ * triangles the source mesh had.
+ */
+class DistanceField
+{
+public:
+    DistanceField() : head(nullptr), table(nullptr), values(nullptr) {}
+
+    DistanceField(const DistanceField &) = delete;
+    DistanceField &operator=(const DistanceField &) = delete;
+
+    bool open(const std::string &path);
+
+    glm::vec3 boundsMin() const { return glm::vec3(head->origin[0], head->origin[1], head->origin[2]); }
+    glm::vec3 boundsMax() const
+    {
+        return boundsMin() + glm::vec3((float)head->bricks[0], (float)head->bricks[1], (float)head->bricks[2]) *
+                                 (float)sdfBrickCells * head->voxelSize;
+    }
+    float band() const { return head->band; }
+
+    /**
+     * @brief Distance to the surface at a world position, clamped to the band, and its gradient.
+     *
+     * Outside the grid the point is taken to be far outside, with a zero gradient,
+     * as it is in bricks that lie entirely outside or inside the band.
+     */
+    float sample(const glm::vec3 &point, glm::vec3 &gradient) const
+    {
+        gradient = glm::vec3(0.0f);
+        glm::vec3 cell = (point - boundsMin()) / head->voxelSize;
+        int brick[3];
+        float t[3];
+        int local[3];
+        for (int axis = 0; axis < 3; axis++)
+        {
+            if (!(cell[axis] >= 0.0f))
+                return head->band;
+            brick[axis] = std::min((int)(cell[axis] / sdfBrickCells), (int)head->bricks[axis] - 1);
+            float within = cell[axis] - brick[axis] * sdfBrickCells;
+            if (within > sdfBrickCells)
+                return head->band;
+            local[axis] = std::min((int)within, sdfBrickCells - 1);
+            t[axis] = within - local[axis];
+        }
+        uint32_t index = table[((size_t)brick[2] * head->bricks[1] + brick[1]) * head->bricks[0] + brick[0]];
+        if (index == sdfBrickOutside)
+            return head->band;
+        if (index == sdfBrickInside)
+            return -head->band;
+
+        const int16_t *v = values + (size_t)index * sdfBrickSamples * sdfBrickSamples * sdfBrickSamples +
+                           (local[2] * sdfBrickSamples + local[1]) * sdfBrickSamples + local[0];
+        const int dy = sdfBrickSamples, dz = sdfBrickSamples * sdfBrickSamples;
+        float c000 = v[0], c100 = v[1], c010 = v[dy], c110 = v[dy + 1];
+        float c001 = v[dz], c101 = v[dz + 1], c011 = v[dz + dy], c111 = v[dz + dy + 1];
+        float x00 = c000 + (c100 - c000) * t[0], x10 = c010 + (c110 - c010) * t[0];
+        float x01 = c001 + (c101 - c001) * t[0], x11 = c011 + (c111 - c011) * t[0];
+        float y0 = x00 + (x10 - x00) * t[1], y1 = x01 + (x11 - x01) * t[1];
+        float scale = head->band / 32767.0f;
+
+        float gx0 = (c100 - c000) + ((c110 - c010) - (c100 - c000)) * t[1];
+        float gx1 = (c101 - c001) + ((c111 - c011) - (c101 - c001)) * t[1];
+        gradient.x = gx0 + (gx1 - gx0) * t[2];
+        gradient.y = (x10 - x00) + ((x11 - x01) - (x10 - x00)) * t[2];
+        gradient.z = y1 - y0;
+        gradient *= scale / head->voxelSize;
+        return (y0 + (y1 - y0) * t[2]) * scale;
+    }
+
+private:
+    Asset asset;
+    const SdfHeader *head;
+    const uint32_t *table;
+    const int16_t *values;
+};
+
+#endif
@@ -0,0 +1,11 @@
+#ifndef EMBEDDEDASSETS_HPP
+#define EMBEDDEDASSETS_HPP
+
+#include <cstddef>
+#include "assetpack.hpp"
+
+// Defined in the source generated by cmake/embed_assets.cmake: the shaders and default sprites
+extern const EmbeddedAsset embeddedAssets[];
+extern const size_t embeddedAssetCount;
+
+#endif
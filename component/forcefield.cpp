@@ -0,0 +1,365 @@
+#include "forcefield.hpp"
+#include "particlesys.hpp"
+
+#include <stdio.h>
+#include <algorithm>
+#include <cmath>
+#include <sstream>
+
+namespace
+{
+    // Kernels: one particle each, inlined into the loops of applyFused()
+
+    struct Gravity
+    {
+        glm::vec3 acceleration;
+        void operator()(Particle &p, float dt) const { p.velocity += acceleration * dt; }
+    };
+
+    struct Wind
+    {
+        glm::vec3 velocity;
+        float coupling;
+        void operator()(Particle &p, float dt) const { p.velocity += (velocity - p.velocity) * (coupling * dt); }
+    };
+
+    struct Attractor
+    {
+        glm::vec3 position;
+        float strength;
+        float softening; // Squared radius, keeps the pull finite at the centre
+        void operator()(Particle &p, float dt) const
+        {
+            glm::vec3 d = position - p.position;
+            float r2 = glm::dot(d, d) + softening;
+            p.velocity += d * (strength * dt / (r2 * std::sqrt(r2)));
+        }
+    };
+
+    struct Vortex
+    {
+        glm::vec3 centre;
+        glm::vec3 axis;
+        float strength;
+        float inverseRadius2;
+        void operator()(Particle &p, float dt) const
+        {
+            glm::vec3 d = p.position - centre;
+            glm::vec3 radial = d - axis * glm::dot(d, axis);
+            float falloff = 1.0f / (1.0f + glm::dot(radial, radial) * inverseRadius2);
+            p.velocity += glm::cross(axis, radial) * (strength * falloff * dt);
+        }
+    };
+
+    struct Drag
+    {
+        float linear;
+        float quadratic;
+        void operator()(Particle &p, float dt) const
+        {
+            float speed = std::sqrt(glm::dot(p.velocity, p.velocity));
+            p.velocity *= std::max(0.0f, 1.0f - (linear + quadratic * speed) * dt);
+        }
+    };
+
+    struct Bounds
+    {
+        glm::vec3 minimum;
+        glm::vec3 maximum;
+        float stiffness;
+        void operator()(Particle &p, float dt) const
+        {
+            glm::vec3 below = glm::max(minimum - p.position, glm::vec3(0.0f));
+            glm::vec3 above = glm::max(p.position - maximum, glm::vec3(0.0f));
+            p.velocity += (below - above) * (stiffness * dt);
+        }
+    };
+
+    struct Turbulence
+    {
+        const CurlNoiseField *noise;
+        float strength;
+        float frequency;
+        glm::vec3 offset; // Scroll so far, in world units
+        void operator()(Particle &p, float dt) const
+        {
+            p.velocity += noise->sample((p.position - offset) * frequency) * (strength * dt);
+        }
+    };
+
+    /**
+     * @brief Runs a kernel only on particles inside a box, for modules limited to a volume.
+     */
+    template <typename Kernel>
+    struct Masked
+    {
+        Kernel kernel;
+        glm::vec3 minimum;
+        glm::vec3 maximum;
+        void operator()(Particle &p, float dt) const
+        {
+            const glm::vec3 &q = p.position;
+            if (q.x >= minimum.x && q.y >= minimum.y && q.z >= minimum.z &&
+                q.x <= maximum.x && q.y <= maximum.y && q.z <= maximum.z)
+                kernel(p, dt);
+        }
+    };
+
+    /**
+     * @brief One pass over the particles applying every module in order.
+     *
+     * The kernels are template arguments, so the compiler inlines them all into
+     * a single loop with no per-particle dispatch.
+     */
+    template <typename... Kernels>
+    void applyFused(Particle *particles, size_t count, float dt, const Kernels &...kernels)
+    {
+        for (size_t i = 0; i < count; i++)
+        {
+            Particle &p = particles[i];
+            (kernels(p, dt), ...);
+        }
+    }
+
+    Gravity gravityKernel(const ForceField &f) { return {f.vector}; }
+    Wind windKernel(const ForceField &f) { return {f.vector, f.strength}; }
+    Attractor attractorKernel(const ForceField &f) { return {f.position, f.strength, f.radius * f.radius}; }
+    Vortex vortexKernel(const ForceField &f) { return {f.position, f.vector, f.strength, 1.0f / (f.radius * f.radius)}; }
+    Drag dragKernel(const ForceField &f) { return {f.linear, f.quadratic}; }
+    Bounds boundsKernel(const ForceField &f) { return {f.position, f.extent, f.strength}; }
+    Turbulence turbulenceKernel(const ForceField &f, float time) { return {f.noise.get(), f.strength, f.frequency, f.vector * time}; }
+
+    /**
+     * @brief One pass of a single module, masked to its volume if it has one.
+     */
+    template <typename Kernel>
+    void applyModule(const ForceField &field, const Kernel &kernel, Particle *particles, size_t count, float dt)
+    {
+        if (field.bounded)
+            applyFused(particles, count, dt, Masked<Kernel>{kernel, field.volumeMin, field.volumeMax});
+        else
+            applyFused(particles, count, dt, kernel);
+    }
+
+    // The fused stacks only cover modules acting everywhere
+
+    bool matches(const std::vector<ForceField> &forces, std::initializer_list<ForceType> types)
+    {
+        if (forces.size() != types.size())
+            return false;
+        size_t i = 0;
+        for (ForceType type : types)
+        {
+            if (forces[i].type != type || forces[i].bounded)
+                return false;
+            i++;
+        }
+        return true;
+    }
+}
+
+ForceField ForceField::gravity(const glm::vec3 &acceleration)
+{
+    ForceField field = {};
+    field.type = FORCE_GRAVITY;
+    field.vector = acceleration;
+    return field;
+}
+
+/**
+ * @param coupling How quickly particles pick up the wind velocity, per second.
+ */
+ForceField ForceField::wind(const glm::vec3 &velocity, float coupling)
+{
+    ForceField field = {};
+    field.type = FORCE_WIND;
+    field.vector = velocity;
+    field.strength = coupling;
+    return field;
+}
+
+/**
+ * @param strength Pull at unit distance; negative to repel.
+ * @param radius Softening radius; the pull stays finite inside it.
+ */
+ForceField ForceField::attractor(const glm::vec3 &position, float strength, float radius)
+{
+    ForceField field = {};
+    field.type = FORCE_ATTRACTOR;
+    field.position = position;
+    field.strength = strength;
+    field.radius = radius;
+    return field;
+}
+
+/**
+ * @param strength Angular acceleration on the axis, radians per second squared.
+ * @param radius Distance from the axis at which the swirl has halved; clamped to
+ * at least 0.001 so the falloff stays finite.
+ */
+ForceField ForceField::vortex(const glm::vec3 &centre, const glm::vec3 &axis, float strength, float radius)
+{
+    ForceField field = {};
+    field.type = FORCE_VORTEX;
+    field.position = centre;
+    field.vector = glm::normalize(axis);
+    field.strength = strength;
+    field.radius = std::max(radius, 0.001f);
+    return field;
+}
+
+ForceField ForceField::drag(float linear, float quadratic)
+{
+    ForceField field = {};
+    field.type = FORCE_DRAG;
+    field.linear = linear;
+    field.quadratic = quadratic;
+    return field;
+}
+
+/**
+ * @param stiffness Acceleration per unit of distance outside the box.
+ */
+ForceField ForceField::bounds(const glm::vec3 &minimum, const glm::vec3 &maximum, float stiffness)
+{
+    ForceField field = {};
+    field.type = FORCE_BOUNDS;
+    field.position = minimum;
+    field.extent = maximum;
+    field.strength = stiffness;
+    return field;
+}
+
+/**
+ * @param noise Baked field, e.g. CurlNoiseField::shared().
+ * @param strength Acceleration at the field's RMS magnitude.
+ * @param frequency Field tiles per world unit; the swirls are about a quarter tile across.
+ * @param scroll Velocity at which the field drifts through the world, for animated turbulence.
+ */
+ForceField ForceField::turbulence(std::shared_ptr<const CurlNoiseField> noise, float strength, float frequency,
+                                  const glm::vec3 &scroll)
+{
+    ForceField field = {};
+    field.type = FORCE_TURBULENCE;
+    field.noise = std::move(noise);
+    field.strength = strength;
+    field.frequency = frequency;
+    field.vector = scroll;
+    return field;
+}
+
+/**
+ * @brief Returns a copy of the module that acts only on particles inside the box minimum..maximum.
+ */
+ForceField ForceField::within(const glm::vec3 &minimum, const glm::vec3 &maximum) const
+{
+    ForceField field = *this;
+    field.bounded = true;
+    field.volumeMin = minimum;
+    field.volumeMax = maximum;
+    return field;
+}
+
+/**
+ * @brief Adds the forces' effect over dt to the particles' velocities.
+ *
+ * Modules apply in order. The common stacks (gravity, gravity + drag,
+ * gravity + wind + drag, gravity + turbulence + drag) run fused in one pass
+ * when none is limited to a volume; anything else runs one pass per module,
+ * each still free of per-particle dispatch.
+ *
+ * @param time Simulation time, which scrolls turbulence fields.
+ */
+void applyForces(const std::vector<ForceField> &forces, Particle *particles, size_t count, float dt, float time)
+{
+    if (matches(forces, {FORCE_GRAVITY}))
+    {
+        applyFused(particles, count, dt, gravityKernel(forces[0]));
+        return;
+    }
+    if (matches(forces, {FORCE_GRAVITY, FORCE_DRAG}))
+    {
+        applyFused(particles, count, dt, gravityKernel(forces[0]), dragKernel(forces[1]));
+        return;
+    }
+    if (matches(forces, {FORCE_GRAVITY, FORCE_WIND, FORCE_DRAG}))
+    {
+        applyFused(particles, count, dt, gravityKernel(forces[0]), windKernel(forces[1]), dragKernel(forces[2]));
+        return;
+    }
+    if (matches(forces, {FORCE_GRAVITY, FORCE_TURBULENCE, FORCE_DRAG}))
+    {
+        applyFused(particles, count, dt, gravityKernel(forces[0]), turbulenceKernel(forces[1], time), dragKernel(forces[2]));
+        return;
+    }
+
+    for (const ForceField &field : forces)
+    {
+        switch (field.type)
+        {
+        case FORCE_GRAVITY:
+            applyModule(field, gravityKernel(field), particles, count, dt);
+            break;
+        case FORCE_WIND:
+            applyModule(field, windKernel(field), particles, count, dt);
+            break;
+        case FORCE_ATTRACTOR:
+            applyModule(field, attractorKernel(field), particles, count, dt);
+            break;
+        case FORCE_VORTEX:
+            applyModule(field, vortexKernel(field), particles, count, dt);
+            break;
+        case FORCE_DRAG:
+            applyModule(field, dragKernel(field), particles, count, dt);
+            break;
+        case FORCE_BOUNDS:
+            applyModule(field, boundsKernel(field), particles, count, dt);
+            break;
+        case FORCE_TURBULENCE:
+            applyModule(field, turbulenceKernel(field, time), particles, count, dt);
+            break;
+        }
+    }
+}
+
+/**
+ * @brief Builds a force stack from a comma-separated list of preset modules, for the command line.
+ *
+ * Names: gravity, wind, attractor, repulsor, vortex, drag, bounds, turbulence,
+ * updraft (wind blowing up inside a column over the emitter). "none" is an empty stack.
+ *
+ * @return false, with a message, on an unknown name.
+ */
+bool parseForces(const std::string &list, std::vector<ForceField> &forces)
+{
+    forces.clear();
+    std::stringstream stream(list);
+    std::string name;
+    while (std::getline(stream, name, ','))
+    {
+        if (name == "gravity")
+            forces.push_back(ForceField::gravity(glm::vec3(0.0f, 0.0f, -2.8f)));
+        else if (name == "wind")
+            forces.push_back(ForceField::wind(glm::vec3(3.0f, 0.0f, 0.0f), 0.5f));
+        else if (name == "attractor")
+            forces.push_back(ForceField::attractor(glm::vec3(0.0f, 0.0f, 5.0f), 40.0f, 1.0f));
+        else if (name == "repulsor")
+            forces.push_back(ForceField::attractor(glm::vec3(0.0f, 0.0f, 5.0f), -40.0f, 1.0f));
+        else if (name == "vortex")
+            forces.push_back(ForceField::vortex(glm::vec3(0.0f), glm::vec3(0.0f, 0.0f, 1.0f), 4.0f, 2.0f));
+        else if (name == "drag")
+            forces.push_back(ForceField::drag(0.1f, 0.02f));
+        else if (name == "bounds")
+            forces.push_back(ForceField::bounds(glm::vec3(-5.0f, -5.0f, 0.0f), glm::vec3(5.0f, 5.0f, 10.0f), 20.0f));
+        else if (name == "turbulence")
+            forces.push_back(ForceField::turbulence(CurlNoiseField::shared(), 6.0f, 0.1f, glm::vec3(0.0f, 0.0f, 1.0f)));
+        else if (name == "updraft")
+            forces.push_back(ForceField::wind(glm::vec3(0.0f, 0.0f, 6.0f), 2.0f).within(glm::vec3(-1.0f, -1.0f, 0.0f), glm::vec3(1.0f, 1.0f, 6.0f)));
+        else if (name != "none")
+        {
+            fprintf(stderr, "Unknown force '%s'; expected gravity, wind, attractor, repulsor, vortex, drag, bounds, turbulence or updraft\n", name.c_str());
+            return false;
+        }
+    }
+    return true;
+}
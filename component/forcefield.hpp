@@ -0,0 +1,58 @@
+#ifndef FORCEFIELD_HPP
+#define FORCEFIELD_HPP
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+#include <glm/glm.hpp>
+#include "curlnoise.hpp"
+
+struct Particle;
+
+enum ForceType
+{
+    FORCE_GRAVITY,    // Constant acceleration
+    FORCE_WIND,       // Pulls velocity towards the wind velocity
+    FORCE_ATTRACTOR,  // Inverse square pull towards a point; negative strength repels
+    FORCE_VORTEX,     // Swirl around an axis, fading with distance from it
+    FORCE_DRAG,       // Linear and quadratic air resistance
+    FORCE_BOUNDS,     // Springs particles back into a box
+    FORCE_TURBULENCE, // Divergence-free swirl from a baked curl-noise field
+};
+
+/**
+ * @brief One force module. Which fields are used depends on the type; build them with the factories.
+ */
+struct ForceField
+{
+    ForceType type;
+    glm::vec3 vector;   // Gravity acceleration, wind velocity, vortex axis (unit length) or turbulence scroll velocity
+    glm::vec3 position; // Attractor or vortex centre, or bounds minimum
+    glm::vec3 extent;   // Bounds maximum
+    float strength;     // Wind coupling, attractor strength, vortex angular speed, bounds stiffness or turbulence acceleration
+    float radius;       // Attractor softening or vortex falloff radius
+    float linear;       // Drag per unit speed
+    float quadratic;    // Drag per squared speed
+    float frequency;    // Turbulence tiles per unit
+    std::shared_ptr<const CurlNoiseField> noise;
+    bool bounded;       // Acts only on particles inside volumeMin..volumeMax
+    glm::vec3 volumeMin;
+    glm::vec3 volumeMax;
+
+    static ForceField gravity(const glm::vec3 &acceleration);
+    static ForceField wind(const glm::vec3 &velocity, float coupling);
+    static ForceField attractor(const glm::vec3 &position, float strength, float radius);
+    static ForceField vortex(const glm::vec3 &centre, const glm::vec3 &axis, float strength, float radius);
+    static ForceField drag(float linear, float quadratic);
+    static ForceField bounds(const glm::vec3 &minimum, const glm::vec3 &maximum, float stiffness);
+    static ForceField turbulence(std::shared_ptr<const CurlNoiseField> noise, float strength, float frequency,
+                                 const glm::vec3 &scroll);
+
+    ForceField within(const glm::vec3 &minimum, const glm::vec3 &maximum) const;
+};
+
+void applyForces(const std::vector<ForceField> &forces, Particle *particles, size_t count, float dt, float time);
+bool parseForces(const std::string &list, std::vector<ForceField> &forces);
+
+#endif
@@ -0,0 +1,285 @@
+#include "frametimer.hpp"
+
+#include <algorithm>
+
+namespace
+{
+    const size_t linearBuckets = 32;
+    const size_t subBuckets = 16;
+    const size_t maxShift = 40;
+
+    double toMillis(uint64_t micros)
+    {
+        return micros / 1000.0;
+    }
+
+    uint64_t microsBetween(std::chrono::steady_clock::time_point from, std::chrono::steady_clock::time_point to)
+    {
+        return std::chrono::duration_cast<std::chrono::microseconds>(to - from).count();
+    }
+}
+
+FrameHistogram::FrameHistogram()
+    : buckets(linearBuckets + subBuckets * maxShift, 0), total(0), maxValue(0), medianBucket(0), belowMedian(0)
+{
+}
+
+/**
+ * @brief Maps a value to its bucket.
+ *
+ * Values below 32 map to themselves. Larger values are shifted right until
+ * they fall in [16, 32); the shift selects the octave and the remaining bits
+ * the linear sub-bucket inside it.
+ */
+size_t FrameHistogram::bucketIndex(uint64_t micros)
+{
+    if (micros < linearBuckets)
+        return micros;
+
+    size_t shift = 1;
+    while ((micros >> shift) >= linearBuckets)
+        shift++;
+    size_t index = linearBuckets + (shift - 1) * subBuckets + ((micros >> shift) - subBuckets);
+    return index < linearBuckets + subBuckets * maxShift ? index : linearBuckets + subBuckets * maxShift - 1;
+}
+
+/**
+ * @brief Returns the largest value that maps to the given bucket.
+ */
+uint64_t FrameHistogram::bucketUpperBound(size_t index)
+{
+    if (index < linearBuckets)
+        return index;
+
+    size_t shift = (index - linearBuckets) / subBuckets + 1;
+    uint64_t sub = (index - linearBuckets) % subBuckets + subBuckets;
+    return ((sub + 1) << shift) - 1;
+}
+
+/**
+ * @brief Adds a sample and moves the median bucket to follow it.
+ *
+ * The median's rank grows by at most one per sample, so the walk only crosses
+ * the buckets between the old and the new median, most of them empty.
+ */
+void FrameHistogram::record(uint64_t micros)
+{
+    size_t index = bucketIndex(micros);
+    buckets[index]++;
+    total++;
+    if (micros > maxValue)
+        maxValue = micros;
+
+    if (index < medianBucket)
+        belowMedian++;
+    uint64_t rank = (total + 1) / 2;
+    while (belowMedian + buckets[medianBucket] < rank)
+        belowMedian += buckets[medianBucket++];
+    while (belowMedian >= rank)
+        belowMedian -= buckets[--medianBucket];
+}
+
+void FrameHistogram::reset()
+{
+    std::fill(buckets.begin(), buckets.end(), 0);
+    total = 0;
+    maxValue = 0;
+    medianBucket = 0;
+    belowMedian = 0;
+}
+
+/**
+ * @brief Returns the value at or below which the given fraction of samples fall.
+ *
+ * @param p Fraction in [0, 1], e.g. 0.99 for p99.
+ * @return Upper bound of the bucket holding the percentile, clamped to the recorded maximum.
+ */
+uint64_t FrameHistogram::percentile(double p) const
+{
+    if (total == 0)
+        return 0;
+
+    uint64_t rank = (uint64_t)(p * total + 0.5);
+    if (rank < 1)
+        rank = 1;
+
+    uint64_t seen = 0;
+    for (size_t i = 0; i < buckets.size(); i++)
+    {
+        seen += buckets[i];
+        if (seen >= rank)
+            return bucketUpperBound(i) < maxValue ? bucketUpperBound(i) : maxValue;
+    }
+    return maxValue;
+}
+
+/**
+ * @brief Same as percentile(0.5), without scanning the buckets.
+ */
+uint64_t FrameHistogram::median() const
+{
+    if (total == 0)
+        return 0;
+    return bucketUpperBound(medianBucket) < maxValue ? bucketUpperBound(medianBucket) : maxValue;
+}
+
+void FrameMetric::record(uint64_t micros, double stutterFactor)
+{
+    // Judge against the median before this sample so a spike can't hide itself
+    if (overall.count() >= 30 && micros > stutterFactor * overall.median())
+    {
+        stutters++;
+        windowStutters++;
+    }
+    overall.record(micros);
+    window.record(micros);
+}
+
+/**
+ * @brief Creates the timer and its GPU queries. Requires a current GL context.
+ *
+ * @param csvPath If not null, per-interval percentiles are appended to this CSV file.
+ * @param reportInterval Seconds between CSV rows. Ignored without a CSV path.
+ */
+FrameTimer::FrameTimer(const char *csvPath, double reportInterval)
+    : cpu("cpu"), gpu("gpu"), present("present"),
+      queryHead(0), queryPending(0), queryActive(false),
+      havePresent(false), csv(nullptr), reportInterval(reportInterval)
+{
+    glGenQueries(queryCount, queries);
+
+    start = lastReport = frameStart = Clock::now();
+    if (csvPath)
+    {
+        csv = fopen(csvPath, "w");
+        if (csv)
+            fprintf(csv, "time_s,metric,frames,p50_ms,p95_ms,p99_ms,max_ms,stutters\n");
+        else
+            fprintf(stderr, "Failed to open frame timing CSV %s\n", csvPath);
+    }
+}
+
+FrameTimer::~FrameTimer()
+{
+    if (queryActive)
+        glEndQuery(GL_TIME_ELAPSED);
+    collectQueries(true);
+
+    if (csv)
+    {
+        writeWindow(std::chrono::duration<double>(Clock::now() - start).count());
+        fclose(csv);
+    }
+    glDeleteQueries(queryCount, queries);
+}
+
+/**
+ * @brief Marks the start of a frame's CPU work and opens a GPU timer query.
+ *
+ * If every query in the ring is still in flight the frame is not GPU-timed,
+ * rather than waiting on the driver.
+ */
+void FrameTimer::beginFrame()
+{
+    frameStart = Clock::now();
+
+    collectQueries(false);
+    queryActive = queryPending < queryCount;
+    if (queryActive)
+        glBeginQuery(GL_TIME_ELAPSED, queries[queryHead]);
+}
+
+/**
+ * @brief Marks the end of the frame's CPU work. Call right before swapping buffers.
+ */
+void FrameTimer::endFrame()
+{
+    if (queryActive)
+    {
+        glEndQuery(GL_TIME_ELAPSED);
+        queryHead = (queryHead + 1) % queryCount;
+        queryPending++;
+        queryActive = false;
+    }
+    cpu.record(microsBetween(frameStart, Clock::now()), stutterFactor);
+}
+
+/**
+ * @brief Marks a completed buffer swap. Call right after swapping buffers.
+ *
+ * Records the present-to-present interval and writes a CSV row when the
+ * report interval has elapsed.
+ */
+void FrameTimer::presented()
+{
+    Clock::time_point now = Clock::now();
+    if (havePresent)
+        present.record(microsBetween(lastPresent, now), stutterFactor);
+    lastPresent = now;
+    havePresent = true;
+
+    if (csv && reportInterval > 0.0 && std::chrono::duration<double>(now - lastReport).count() >= reportInterval)
+    {
+        writeWindow(std::chrono::duration<double>(now - start).count());
+        lastReport = now;
+    }
+}
+
+/**
+ * @brief Reads back finished GPU queries, oldest first.
+ *
+ * @param wait Block until every pending query has a result.
+ */
+void FrameTimer::collectQueries(bool wait)
+{
+    while (queryPending > 0)
+    {
+        GLuint query = queries[(queryHead - queryPending + queryCount) % queryCount];
+        if (!wait)
+        {
+            GLint available = 0;
+            glGetQueryObjectiv(query, GL_QUERY_RESULT_AVAILABLE, &available);
+            if (!available)
+                break;
+        }
+        GLuint64 nanos = 0;
+        glGetQueryObjectui64v(query, GL_QUERY_RESULT, &nanos);
+        gpu.record(nanos / 1000, stutterFactor);
+        queryPending--;
+    }
+}
+
+void FrameTimer::writeWindow(double elapsed)
+{
+    FrameMetric *metrics[] = {&cpu, &gpu, &present};
+    for (FrameMetric *metric : metrics)
+    {
+        const FrameHistogram &h = metric->window;
+        fprintf(csv, "%.3f,%s,%llu,%.3f,%.3f,%.3f,%.3f,%llu\n",
+                elapsed, metric->name, (unsigned long long)h.count(),
+                toMillis(h.percentile(0.50)), toMillis(h.percentile(0.95)),
+                toMillis(h.percentile(0.99)), toMillis(h.max()),
+                (unsigned long long)metric->windowStutters);
+        metric->window.reset();
+        metric->windowStutters = 0;
+    }
+    fflush(csv);
+}
+
+/**
+ * @brief Prints percentiles and stutter counts over the whole run.
+ */
+void FrameTimer::report(FILE *out) const
+{
+    const FrameMetric *metrics[] = {&cpu, &gpu, &present};
+    fprintf(out, "Frame timing (ms)   frames      p50      p95      p99      max  stutters\n");
+    for (const FrameMetric *metric : metrics)
+    {
+        const FrameHistogram &h = metric->overall;
+        fprintf(out, "  %-16s %8llu %8.3f %8.3f %8.3f %8.3f %9llu\n",
+                metric->name, (unsigned long long)h.count(),
+                toMillis(h.percentile(0.50)), toMillis(h.percentile(0.95)),
+                toMillis(h.percentile(0.99)), toMillis(h.max()),
+                (unsigned long long)metric->stutters);
+    }
+}
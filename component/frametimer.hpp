@@ -0,0 +1,106 @@
+#ifndef FRAMETIMER_HPP
+#define FRAMETIMER_HPP
+
+#include <GL/glew.h>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Log-bucketed histogram of durations in microseconds.
+ *
+ * Values below 32us get their own bucket; above that every power of two is
+ * split into 16 linear sub-buckets, so any recorded value is reported with
+ * better than ~6% relative error and memory stays constant. The median is
+ * tracked as samples arrive, so reading it doesn't scan the buckets.
+ */
+class FrameHistogram
+{
+public:
+    FrameHistogram();
+
+    void record(uint64_t micros);
+    void reset();
+
+    uint64_t count() const { return total; }
+    uint64_t max() const { return maxValue; }
+    uint64_t percentile(double p) const;
+    uint64_t median() const;
+
+private:
+    static size_t bucketIndex(uint64_t micros);
+    static uint64_t bucketUpperBound(size_t index);
+
+    std::vector<uint64_t> buckets;
+    uint64_t total;
+    uint64_t maxValue;
+    size_t medianBucket;  // Bucket holding the median sample
+    uint64_t belowMedian; // Samples in the buckets before it
+};
+
+/**
+ * @brief Percentiles and stutter count for one timed quantity.
+ *
+ * A stutter is a sample longer than stutterFactor times the running median.
+ */
+struct FrameMetric
+{
+    const char *name;
+    FrameHistogram overall;
+    FrameHistogram window;
+    uint64_t stutters = 0;
+    uint64_t windowStutters = 0;
+
+    explicit FrameMetric(const char *name) : name(name) {}
+    void record(uint64_t micros, double stutterFactor);
+};
+
+/**
+ * @brief Measures CPU frame time, GPU frame time and present-to-present interval.
+ *
+ * Call beginFrame() at the top of the frame, endFrame() right before the swap and
+ * presented() right after it. GPU time comes from GL_TIME_ELAPSED queries kept in
+ * a small ring so reading them back never stalls the pipeline.
+ */
+class FrameTimer
+{
+public:
+    FrameTimer(const char *csvPath = nullptr, double reportInterval = 0.0);
+    ~FrameTimer();
+
+    void beginFrame();
+    void endFrame();
+    void presented();
+    void report(FILE *out) const;
+
+    double stutterFactor = 2.0;
+
+private:
+    typedef std::chrono::steady_clock Clock;
+    static const int queryCount = 4;
+
+    void collectQueries(bool wait);
+    void writeWindow(double elapsed);
+
+    FrameMetric cpu;
+    FrameMetric gpu;
+    FrameMetric present;
+
+    GLuint queries[queryCount];
+    int queryHead;
+    int queryPending;
+    bool queryActive;
+
+    Clock::time_point start;
+    Clock::time_point frameStart;
+    Clock::time_point lastPresent;
+    Clock::time_point lastReport;
+    bool havePresent;
+
+    FILE *csv;
+    double reportInterval;
+};
+
+#endif
@@ -0,0 +1,132 @@
+#include "geometry.hpp"
+
+#include <cstddef>
+
+namespace
+{
+    template <int VertexCount, int IndexCount>
+    struct MeshData
+    {
+        MeshVertex vertices[VertexCount] = {};
+        GLushort indices[IndexCount] = {};
+    };
+
+    constexpr GLfloat cornerU[4] = {-1.0f, 1.0f, 1.0f, -1.0f};
+    constexpr GLfloat cornerV[4] = {-1.0f, -1.0f, 1.0f, 1.0f};
+
+    /**
+     * @brief Six faces, each a quad spanned by the two axes after its normal axis.
+     */
+    constexpr MeshData<24, 36> makeCube()
+    {
+        MeshData<24, 36> mesh;
+        int face = 0;
+        for (int axis = 0; axis < 3; axis++)
+        {
+            for (int side = -1; side <= 1; side += 2, face++)
+            {
+                for (int corner = 0; corner < 4; corner++)
+                {
+                    MeshVertex &vertex = mesh.vertices[face * 4 + corner];
+                    vertex.position[axis] = (GLfloat)side;
+                    vertex.position[(axis + 1) % 3] = cornerU[corner];
+                    vertex.position[(axis + 2) % 3] = cornerV[corner];
+                    vertex.uv[0] = cornerU[corner] * 0.5f + 0.5f;
+                    vertex.uv[1] = cornerV[corner] * 0.5f + 0.5f;
+                }
+                // Counter-clockwise seen from outside: the corners wind around +axis, so flip the -axis face
+                const int positive[6] = {0, 1, 2, 0, 2, 3};
+                const int negative[6] = {0, 2, 1, 0, 3, 2};
+                for (int i = 0; i < 6; i++)
+                    mesh.indices[face * 6 + i] = (GLushort)(face * 4 + (side > 0 ? positive[i] : negative[i]));
+            }
+        }
+        return mesh;
+    }
+
+    constexpr MeshData<4, 6> makeQuad()
+    {
+        MeshData<4, 6> mesh;
+        for (int corner = 0; corner < 4; corner++)
+        {
+            MeshVertex &vertex = mesh.vertices[corner];
+            vertex.position[0] = cornerU[corner];
+            vertex.position[1] = cornerV[corner];
+            vertex.uv[0] = cornerU[corner] * 0.5f + 0.5f;
+            vertex.uv[1] = cornerV[corner] * 0.5f + 0.5f;
+        }
+        const int indices[6] = {0, 1, 2, 0, 2, 3};
+        for (int i = 0; i < 6; i++)
+            mesh.indices[i] = (GLushort)indices[i];
+        return mesh;
+    }
+
+    constexpr MeshData<24, 36> cube = makeCube();
+    constexpr MeshData<4, 6> quad = makeQuad();
+    constexpr MeshData<1, 1> point = {{{{0.0f, 0.0f, 0.0f}, {0.5f, 0.5f}}}, {0}};
+
+    static_assert(cube.indices[35] == 23, "cube faces are generated at compile time");
+}
+
+GeometryRegistry &GeometryRegistry::instance()
+{
+    static GeometryRegistry registry;
+    return registry;
+}
+
+GeometryRegistry::GeometryRegistry()
+{
+    const GLenum modes[MESH_COUNT] = {GL_TRIANGLES, GL_TRIANGLES, GL_POINTS};
+    const GLsizei counts[MESH_COUNT] = {36, 6, 1};
+    for (int type = 0; type < MESH_COUNT; type++)
+        meshes[type] = {0, 0, modes[type], counts[type]};
+}
+
+/**
+ * @brief Binds a mesh's buffers to the current VAO and points attributes 0 and 1 at it.
+ *
+ * Uploads the mesh the first time it is asked for.
+ *
+ * @return The mesh, for its draw mode and index count.
+ */
+const Mesh &GeometryRegistry::bind(MeshType type)
+{
+    Mesh &mesh = meshes[type];
+    if (mesh.vertexbuffer == 0)
+    {
+        const void *vertices[MESH_COUNT] = {cube.vertices, quad.vertices, point.vertices};
+        const GLsizeiptr vertexBytes[MESH_COUNT] = {sizeof(cube.vertices), sizeof(quad.vertices), sizeof(point.vertices)};
+        const void *indices[MESH_COUNT] = {cube.indices, quad.indices, point.indices};
+        const GLsizeiptr indexBytes[MESH_COUNT] = {sizeof(cube.indices), sizeof(quad.indices), sizeof(point.indices)};
+
+        glGenBuffers(1, &mesh.vertexbuffer);
+        glBindBuffer(GL_ARRAY_BUFFER, mesh.vertexbuffer);
+        glBufferData(GL_ARRAY_BUFFER, vertexBytes[type], vertices[type], GL_STATIC_DRAW);
+        glGenBuffers(1, &mesh.indexbuffer);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh.indexbuffer);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, indexBytes[type], indices[type], GL_STATIC_DRAW);
+    }
+
+    glBindBuffer(GL_ARRAY_BUFFER, mesh.vertexbuffer);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh.indexbuffer);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(MeshVertex), (void *)offsetof(MeshVertex, position));
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(MeshVertex), (void *)offsetof(MeshVertex, uv));
+    return mesh;
+}
+
+/**
+ * @brief Deletes every uploaded mesh. Meshes are uploaded again if bound afterwards.
+ */
+void GeometryRegistry::clear()
+{
+    for (Mesh &mesh : meshes)
+    {
+        if (mesh.vertexbuffer)
+            glDeleteBuffers(1, &mesh.vertexbuffer);
+        if (mesh.indexbuffer)
+            glDeleteBuffers(1, &mesh.indexbuffer);
+        mesh.vertexbuffer = mesh.indexbuffer = 0;
+    }
+}
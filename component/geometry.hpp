@@ -0,0 +1,59 @@
+#ifndef GEOMETRY_HPP
+#define GEOMETRY_HPP
+
+#include <GL/glew.h>
+
+/**
+ * @brief The unit meshes shared through GeometryRegistry.
+ */
+enum MeshType
+{
+    MESH_CUBE,  // -1..1 on every axis, 4 vertices per face so each face has its own UVs
+    MESH_QUAD,  // -1..1 in the xy plane, facing +z
+    MESH_POINT, // One vertex at the origin, drawn as GL_POINTS
+    MESH_COUNT,
+};
+
+/**
+ * @brief Interleaved vertex of the unit meshes: position at attribute 0, UV at attribute 1.
+ */
+struct MeshVertex
+{
+    GLfloat position[3];
+    GLfloat uv[2];
+};
+
+/**
+ * @brief GPU buffers of one unit mesh. Indices are GL_UNSIGNED_SHORT.
+ */
+struct Mesh
+{
+    GLuint vertexbuffer;
+    GLuint indexbuffer;
+    GLenum mode;
+    GLsizei indexCount;
+};
+
+/**
+ * @brief Owns one copy of each unit mesh for the whole process.
+ *
+ * The vertex and index data are generated at compile time and uploaded on
+ * first use; every VAO that draws a mesh references the same buffers. Meshes
+ * are indexed so shared corners go through the post-transform vertex cache
+ * once. Call clear() before the GL context is destroyed.
+ */
+class GeometryRegistry
+{
+public:
+    static GeometryRegistry &instance();
+
+    const Mesh &bind(MeshType type);
+    void clear();
+
+private:
+    GeometryRegistry();
+
+    Mesh meshes[MESH_COUNT];
+};
+
+#endif
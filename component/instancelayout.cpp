@@ -0,0 +1,91 @@
+#include "instancelayout.hpp"
+
+#include <cstddef>
+
+namespace
+{
+    struct InstanceAttribute
+    {
+        GLuint location;
+        GLint components;
+        GLenum type;
+        GLboolean normalized;
+        size_t offset;
+    };
+
+    static_assert(sizeof(FloatInstance) == 40 && sizeof(CompactInstance) == 24 && sizeof(HalfInstance) == 16,
+                  "instance layouts are tightly packed");
+
+    const GLuint positionLocation = 2, sizeLocation = 3, colorLocation = 4, ageLocation = 5, layerLocation = 6;
+
+    const InstanceAttribute floatAttributes[] = {
+        {positionLocation, 3, GL_FLOAT, GL_FALSE, offsetof(FloatInstance, position)},
+        {sizeLocation, 1, GL_FLOAT, GL_FALSE, offsetof(FloatInstance, size)},
+        {colorLocation, 4, GL_FLOAT, GL_FALSE, offsetof(FloatInstance, color)},
+        {ageLocation, 1, GL_FLOAT, GL_FALSE, offsetof(FloatInstance, age)},
+        {layerLocation, 1, GL_FLOAT, GL_FALSE, offsetof(FloatInstance, layer)},
+    };
+
+    const InstanceAttribute compactAttributes[] = {
+        {positionLocation, 3, GL_FLOAT, GL_FALSE, offsetof(CompactInstance, position)},
+        {sizeLocation, 1, GL_HALF_FLOAT, GL_FALSE, offsetof(CompactInstance, size)},
+        {colorLocation, 4, GL_UNSIGNED_BYTE, GL_TRUE, offsetof(CompactInstance, color)},
+        {ageLocation, 1, GL_UNSIGNED_SHORT, GL_TRUE, offsetof(CompactInstance, age)},
+        {layerLocation, 1, GL_UNSIGNED_SHORT, GL_FALSE, offsetof(CompactInstance, layer)},
+    };
+
+    const InstanceAttribute halfAttributes[] = {
+        {positionLocation, 3, GL_HALF_FLOAT, GL_FALSE, offsetof(HalfInstance, position)},
+        {sizeLocation, 1, GL_HALF_FLOAT, GL_FALSE, offsetof(HalfInstance, size)},
+        {colorLocation, 4, GL_UNSIGNED_BYTE, GL_TRUE, offsetof(HalfInstance, color)},
+        {ageLocation, 1, GL_UNSIGNED_SHORT, GL_TRUE, offsetof(HalfInstance, age)},
+        {layerLocation, 1, GL_UNSIGNED_SHORT, GL_FALSE, offsetof(HalfInstance, layer)},
+    };
+}
+
+const char *instanceLayoutName(InstanceLayout layout)
+{
+    switch (layout)
+    {
+    case INSTANCE_FLOAT:
+        return "float";
+    case INSTANCE_HALF:
+        return "half";
+    default:
+        return "compact";
+    }
+}
+
+GLsizei instanceStride(InstanceLayout layout)
+{
+    switch (layout)
+    {
+    case INSTANCE_FLOAT:
+        return sizeof(FloatInstance);
+    case INSTANCE_HALF:
+        return sizeof(HalfInstance);
+    default:
+        return sizeof(CompactInstance);
+    }
+}
+
+/**
+ * @brief Points the instance attributes of the current VAO at the buffer bound to GL_ARRAY_BUFFER.
+ *
+ * Each attribute advances once per instance.
+ */
+void bindInstanceLayout(InstanceLayout layout)
+{
+    const InstanceAttribute *attributes = layout == INSTANCE_FLOAT ? floatAttributes
+                                          : layout == INSTANCE_HALF ? halfAttributes
+                                                                    : compactAttributes;
+    GLsizei stride = instanceStride(layout);
+    for (int i = 0; i < 5; i++)
+    {
+        const InstanceAttribute &attribute = attributes[i];
+        glEnableVertexAttribArray(attribute.location);
+        glVertexAttribPointer(attribute.location, attribute.components, attribute.type, attribute.normalized, stride,
+                              (void *)attribute.offset);
+        glVertexAttribDivisor(attribute.location, 1);
+    }
+}
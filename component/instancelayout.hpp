@@ -0,0 +1,94 @@
+#ifndef INSTANCELAYOUT_HPP
+#define INSTANCELAYOUT_HPP
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/packing.hpp>
+
+/**
+ * @brief Encoding of the per-particle attributes streamed to the GPU each frame.
+ *
+ * All layouts feed the same shader inputs (position, size, color, age, layer at
+ * attribute locations 2 to 6); the vertex fetch converts half floats and
+ * normalized integers, so the shader needs no per-layout code.
+ */
+enum InstanceLayout
+{
+    INSTANCE_FLOAT,   // 32-bit floats throughout, 40 bytes
+    INSTANCE_COMPACT, // Float position, half size, RGBA8 color, unorm16 age, 24 bytes
+    INSTANCE_HALF,    // Half position and size, RGBA8 color, unorm16 age, 16 bytes
+};
+
+struct FloatInstance
+{
+    glm::vec3 position;
+    GLfloat size;
+    glm::vec4 color;
+    GLfloat age; // Fraction of the lifetime elapsed
+    GLfloat layer;
+};
+
+struct CompactInstance
+{
+    glm::vec3 position;
+    GLubyte color[4];
+    GLushort size; // Half float
+    GLushort age;  // Unorm16
+    GLushort layer;
+    GLushort padding;
+};
+
+/**
+ * @brief Half precision has a 10-bit mantissa: positions within 8 units of the
+ * origin keep about 1/128 unit, which is coarse next to the smallest particles.
+ */
+struct HalfInstance
+{
+    GLushort position[3]; // Half float
+    GLushort size;        // Half float
+    GLubyte color[4];
+    GLushort age; // Unorm16
+    GLushort layer;
+};
+
+const char *instanceLayoutName(InstanceLayout layout);
+GLsizei instanceStride(InstanceLayout layout);
+void bindInstanceLayout(InstanceLayout layout);
+
+inline GLubyte packUnorm8(float value)
+{
+    return (GLubyte)(glm::clamp(value, 0.0f, 1.0f) * 255.0f + 0.5f);
+}
+
+inline void packInstance(FloatInstance &out, const glm::vec3 &position, float size, const glm::vec4 &color, float age, int layer)
+{
+    out.position = position;
+    out.size = size;
+    out.color = color;
+    out.age = age;
+    out.layer = (GLfloat)layer;
+}
+
+inline void packInstance(CompactInstance &out, const glm::vec3 &position, float size, const glm::vec4 &color, float age, int layer)
+{
+    out.position = position;
+    for (int c = 0; c < 4; c++)
+        out.color[c] = packUnorm8(color[c]);
+    out.size = glm::packHalf1x16(size);
+    out.age = glm::packUnorm1x16(age);
+    out.layer = (GLushort)layer;
+    out.padding = 0;
+}
+
+inline void packInstance(HalfInstance &out, const glm::vec3 &position, float size, const glm::vec4 &color, float age, int layer)
+{
+    for (int c = 0; c < 3; c++)
+        out.position[c] = glm::packHalf1x16(position[c]);
+    out.size = glm::packHalf1x16(size);
+    for (int c = 0; c < 4; c++)
+        out.color[c] = packUnorm8(color[c]);
+    out.age = glm::packUnorm1x16(age);
+    out.layer = (GLushort)layer;
+}
+
+#endif
@@ -0,0 +1,52 @@
+#include "lifecurves.hpp"
+
+/**
+ * @brief The default look: the spawn color dims to black while the alpha fades out.
+ */
+LifeCurves LifeCurves::fade()
+{
+    LifeCurves curves;
+    curves.color = {{0.0f, glm::vec3(1.0f)}, {1.0f, glm::vec3(0.0f)}};
+    curves.alpha = {{0.0f, 0.6f}, {1.0f, 0.0f}};
+    return curves;
+}
+
+/**
+ * @brief Samples the curves into a two-layer GL_TEXTURE_1D_ARRAY.
+ *
+ * Layer 0 holds the color multiplier in rgb and alpha in a; layer 1 holds the
+ * size multiplier in r. Texel i is the curve at age i / (resolution - 1), so
+ * the shader hits the first and last keys exactly at ages 0 and 1.
+ *
+ * @param resolution Texels per curve.
+ * @return The texture; the caller deletes it.
+ */
+GLuint bakeLifeCurves(const LifeCurves &curves, int resolution)
+{
+    std::vector<GLfloat> texels((size_t)resolution * 2 * 4);
+    for (int i = 0; i < resolution; i++)
+    {
+        float age = resolution > 1 ? (float)i / (resolution - 1) : 0.0f;
+        glm::vec3 color = evaluateCurve(curves.color, age, glm::vec3(1.0f));
+        GLfloat *texel = &texels[(size_t)i * 4];
+        texel[0] = color.r;
+        texel[1] = color.g;
+        texel[2] = color.b;
+        texel[3] = evaluateCurve(curves.alpha, age, 1.0f);
+        texel = &texels[((size_t)resolution + i) * 4];
+        texel[0] = evaluateCurve(curves.size, age, 1.0f);
+        texel[1] = texel[2] = 0.0f;
+        texel[3] = 1.0f;
+    }
+
+    GLuint texture;
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_1D_ARRAY, texture);
+    // Half floats so size multipliers above 1 and fine alpha steps survive
+    glTexImage2D(GL_TEXTURE_1D_ARRAY, 0, GL_RGBA16F, resolution, 2, 0, GL_RGBA, GL_FLOAT, texels.data());
+    glTexParameteri(GL_TEXTURE_1D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_1D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_1D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glBindTexture(GL_TEXTURE_1D_ARRAY, 0);
+    return texture;
+}
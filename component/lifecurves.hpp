@@ -0,0 +1,61 @@
+#ifndef LIFECURVES_HPP
+#define LIFECURVES_HPP
+
+#include <GL/glew.h>
+#include <vector>
+#include <glm/glm.hpp>
+
+/**
+ * @brief One control point of a curve over a particle's life.
+ */
+template <typename T>
+struct CurveKey
+{
+    float age; // Fraction of the lifetime elapsed, 0 to 1
+    T value;
+};
+
+/**
+ * @brief Piecewise linear curve; keys sorted by age. Held flat before the first and after the last key.
+ */
+template <typename T>
+using Curve = std::vector<CurveKey<T>>;
+
+template <typename T>
+T evaluateCurve(const Curve<T> &curve, float age, const T &fallback)
+{
+    if (curve.empty())
+        return fallback;
+    if (age <= curve.front().age)
+        return curve.front().value;
+    for (size_t i = 1; i < curve.size(); i++)
+    {
+        if (age <= curve[i].age)
+        {
+            const CurveKey<T> &a = curve[i - 1], &b = curve[i];
+            float t = b.age > a.age ? (age - a.age) / (b.age - a.age) : 1.0f;
+            return a.value + (b.value - a.value) * t;
+        }
+    }
+    return curve.back().value;
+}
+
+/**
+ * @brief Multipliers applied to a particle's spawn color, alpha and size over its life.
+ *
+ * The curves are baked into a lookup texture and evaluated by the vertex
+ * shader from each particle's normalized age, so the simulation never touches
+ * color or size after respawn. An empty curve is a constant 1.
+ */
+struct LifeCurves
+{
+    Curve<glm::vec3> color;
+    Curve<float> alpha;
+    Curve<float> size;
+
+    static LifeCurves fade();
+};
+
+GLuint bakeLifeCurves(const LifeCurves &curves, int resolution = 256);
+
+#endif
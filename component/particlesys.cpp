@@ -1,48 +1,79 @@
+#include <stdio.h>
+#include <cfloat>
+#include <cmath>
+#include <algorithm>
 #include "particlesys.hpp"
+#include "threadpool.hpp"
 
 /**
  * @brief Constructs a ParticleSystem with a specified number of particles.
  * 
  * This constructor initializes the particle system by reserving space for the particles,
  * loading shaders and textures, and setting up the necessary OpenGL buffers and attributes.
+ * The particle shader is taken from the ShaderVariants cache with the TEXTURED feature,
+ * plus ATLAS when the config asks for an atlas of several or animated sprites, and
+ * LIFE_CURVES, which applies the config's curves over life from a baked lookup texture.
  * 
  * @param numParticles The number of particles to initialize in the system.
+ * @param config Emitter settings; by default the sprite is generated procedurally.
  * 
  * @throws std::exception If any error occurs during initialization.
  */
-ParticleSystem::ParticleSystem(unsigned int numParticles)
+ParticleSystem::ParticleSystem(unsigned int numParticles, const EmitterConfig &config)
 {
     try
     {
         this->numParticles = numParticles;
+        this->config = config;
+        if (config.mode == SIM_SPH)
+            this->config.neighborRadius = std::max(config.neighborRadius, config.sph.smoothingRadius);
+        if (config.mode == SIM_BOIDS)
+            this->config.neighborRadius = std::max(config.neighborRadius, config.boids.perceptionRadius);
         particles.reserve(numParticles);
 
-        this->programID = LoadShaders("../shader/particle_v.glsl", "../shader/particle_f.glsl");
-        this->textureID = loadTexture("../texture/Fire.jpg");
+        // Build the soft variant alongside the default one so toggling it later doesn't hitch
+        this->shaderFeatures = SHADER_TEXTURED | SHADER_LIFE_CURVES | (config.atlasSprites.empty() ? 0u : (unsigned int)SHADER_ATLAS);
+        ShaderVariants::instance().prewarm("../shader/particle_v.glsl", "../shader/particle_f.glsl",
+                                           {shaderFeatures, shaderFeatures | SHADER_SOFT});
+        this->shader = ShaderVariants::instance().get("../shader/particle_v.glsl", "../shader/particle_f.glsl", shaderFeatures);
+        this->programID = shader->program;
+        if (!config.atlasSprites.empty())
+        {
+            int size = spriteResolution(config.quality);
+            atlas.reset(new SpriteAtlas(size));
+            for (const SpriteParams &sprite : config.atlasSprites)
+                atlas->addSequence(generateFlipbook(sprite, size, std::max(1, config.flipbookFrames)));
+            if (!config.spritePath.empty())
+                atlas->addFile(config.spritePath);
+            atlas->build();
+            this->textureID = atlas->texture();
+        }
+        else
+        {
+            if (config.spritePath.empty())
+                this->texture = TextureManager::instance().acquireSprite(config.sprite, spriteResolution(config.quality));
+            else
+                this->texture = TextureManager::instance().acquire(config.spritePath);
+            this->textureID = texture.id();
+        }
         if (textureID == 0)
         {
             std::cerr << "Failed to load texture!" << std::endl;
         }
+        this->lifeCurveTexture = bakeLifeCurves(config.curves);
 
         glGenVertexArrays(1, &VAO);
         glBindVertexArray(VAO);
 
-        glGenBuffers(1, &vertexbuffer);
-        glBindBuffer(GL_ARRAY_BUFFER, vertexbuffer);
-        glBufferData(GL_ARRAY_BUFFER, sizeof(g_vertex_buffer_data), g_vertex_buffer_data, GL_DYNAMIC_DRAW);
-
-        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, (void *)0);
-
-        GLuint uvbuffer;
-        glGenBuffers(1, &uvbuffer);
-        glBindBuffer(GL_ARRAY_BUFFER, uvbuffer);
-        glBufferData(GL_ARRAY_BUFFER, sizeof(g_uv_buffer_data), g_uv_buffer_data, GL_STATIC_DRAW);
+        // The unit cube is shared by every system; the VAO only references its buffers
+        mesh = &GeometryRegistry::instance().bind(MESH_CUBE);
 
-        glEnableVertexAttribArray(1);
-        glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 0, (void *)0);
+        // Per-particle attributes, refilled every frame by render()
+        glGenBuffers(1, &instancebuffer);
+        glBindBuffer(GL_ARRAY_BUFFER, instancebuffer);
+        bindInstanceLayout(config.instanceLayout);
 
-        // glEnableVertexAttribArray(1);
-        glEnableVertexAttribArray(0);
+        glBindVertexArray(0);
 
         // glBindBuffer(GL_ARRAY_BUFFER, 0);
         // glBindVertexArray(0);
@@ -54,6 +85,16 @@ ParticleSystem::ParticleSystem(unsigned int numParticles)
     // this->emit();
 }
 
+/**
+ * @brief Releases the system's VAO and instance buffer. The shared mesh stays with GeometryRegistry.
+ */
+ParticleSystem::~ParticleSystem()
+{
+    glDeleteVertexArrays(1, &VAO);
+    glDeleteBuffers(1, &instancebuffer);
+    glDeleteTextures(1, &lifeCurveTexture);
+}
+
 /**
  * @brief Emits particles by resizing the particle container and respawning each particle.
  * 
@@ -73,6 +114,19 @@ void ParticleSystem::emit()
         {
             respawn(particles[i]);
         }
+        // A fluid starts at rest, packed on a lattice through the spawn block and stacked above it if it overflows
+        if (config.mode == SIM_SPH)
+        {
+            const SphParams &sph = config.sph;
+            float spacing = sph.spacing();
+            int columns = std::max(1, (int)((sph.spawnMax.x - sph.spawnMin.x) / spacing));
+            int rows = std::max(1, (int)((sph.spawnMax.y - sph.spawnMin.y) / spacing));
+            for (unsigned int i = 0; i < numParticles; i++)
+            {
+                glm::vec3 cell((float)(i % columns), (float)(i / columns % rows), (float)(i / columns / rows));
+                particles[i].position = sph.spawnMin + (cell + 0.5f) * spacing;
+            }
+        }
     }
     catch (const std::exception &e)
     {
@@ -83,92 +137,177 @@ void ParticleSystem::emit()
 /**
  * @brief Updates the state of all particles in the system.
  * 
- * This function iterates through all particles in the system, updating their
- * velocity, position, and lifetime based on the elapsed time (dt). It also
- * updates the color of each particle based on its remaining lifetime. If a
- * particle's lifetime reaches zero, it is respawned.
+ * Sprites take one step per call. A fluid (SIM_SPH) splits dt into substeps no
+ * longer than SphParams::maxTimeStep, which the pressure solve needs to stay stable.
  * 
  * @param dt The elapsed time since the last update, in seconds.
  */
 void ParticleSystem::update(float dt)
 {
-    for (int i = this->particles.size() - 1; i >= 0; i--)
-    {
-        Particle &p = particles[i];
-        p.velocity += p.acceleration2 * dt;
-        p.position += p.velocity * dt;
-        p.lifetime -= dt;
-
-        // Update color based on remaining lifetime
-        float lifeRatio = p.lifetime / 2.0f; // Assuming the maximum lifetime is 2.0f
-        p.color = glm::vec4(lifeRatio, lifeRatio, lifeRatio, 1.0f);
-        p.color.a = p.lifetime / 4.0f;
-        // float lifeRatio = p.lifetime / 2.0f; // Assuming the maximum lifetime is 2.0f
-        // p.color = glm::vec4(1.0f, lifeRatio, lifeRatio, 1.0f);
-        // p.color.a = p.lifetime / 2.0f;
-
-        if (p.lifetime <= 0.0f)
+    int substeps = 1;
+    if (config.mode == SIM_SPH)
+        substeps = std::max(1, (int)std::ceil(dt / config.sph.maxTimeStep));
+    for (int i = 0; i < substeps; i++)
+    {
+        step(dt / substeps);
+    }
+}
+
+/**
+ * @brief Advances every particle by one step.
+ * 
+ * When the config sets a neighbour radius, the particles are first binned into
+ * the spatial grid and reordered by cell, so particles close in space are close
+ * in memory for any pass that looks at neighbours; a fluid then gets its
+ * pressure and viscosity accelerations from those neighbours. Bodies
+ * (SIM_NBODY) get their mutual gravity from a Barnes-Hut tree, and boids
+ * (SIM_BOIDS) steer by their grid neighbours. This function
+ * then applies the configured force modules to every particle's velocity, and
+ * iterates through all particles, updating their position and lifetime based
+ * on the elapsed time (dt) and tracking the bounds of the system. Color and
+ * size keep their spawn values; the shader scales them by the curves over
+ * life from each particle's age. The configured colliders then resolve
+ * contacts in their own pass, skipping any whose broad-phase box misses those
+ * bounds. Particles whose lifetime reaches zero, or that hit a kill collider,
+ * are collected and respawned in a last pass, so the integration and respawn
+ * kernels can be measured separately.
+ * 
+ * @param dt The step length, in seconds.
+ */
+void ParticleSystem::step(float dt)
+{
+    expired.clear();
+    if (config.neighborRadius > 0.0f && !particles.empty())
+    {
+        PerfScope scope(perfCounters.get(), stats.grid);
+        grid.build(&particles[0].position, particles.size(), sizeof(Particle), config.neighborRadius);
+        grid.reorder(particles, reordered);
+    }
+    if (config.mode == SIM_SPH && !particles.empty())
+    {
+        PerfScope scope(perfCounters.get(), stats.sph);
+        sph.step(particles, grid, config.sph, dt);
+    }
+    if (config.mode == SIM_NBODY && !particles.empty())
+    {
+        PerfScope scope(perfCounters.get(), stats.nbody);
+        tree.build(particles.data(), particles.size());
+        tree.accelerate(particles.data(), config.nbody, dt);
+    }
+    if (config.mode == SIM_BOIDS && !particles.empty())
+    {
+        PerfScope scope(perfCounters.get(), stats.boids);
+        flock.step(particles, grid, config.colliders, config.boids, dt);
+    }
+    glm::vec3 boundsMin(FLT_MAX), boundsMax(-FLT_MAX);
+    float maxSize = 0.0f;
+    {
+        PerfScope scope(perfCounters.get(), stats.update);
+        time += dt;
+        applyForces(config.forces, particles.data(), particles.size(), dt, time);
+        for (unsigned int i = 0; i < particles.size(); i++)
         {
-            respawn(p);
+            Particle &p = particles[i];
+            p.position += p.velocity * dt;
+            p.lifetime -= dt;
+            boundsMin = glm::min(boundsMin, p.position);
+            boundsMax = glm::max(boundsMax, p.position);
+            maxSize = std::max(maxSize, p.size);
+
+            if (p.lifetime <= 0.0f)
+            {
+                expired.push_back(i);
+            }
         }
-        // if (p.lifetime <= 0.0f)
-        // {
-        //     particles.erase(particles.begin() + i);
-        // }
     }
+    if (!config.colliders.empty() && !particles.empty())
+    {
+        PerfScope scope(perfCounters.get(), stats.collide);
+        collideParticles(config.colliders, particles.data(), particles.size(), boundsMin - glm::vec3(maxSize),
+                         boundsMax + glm::vec3(maxSize), expired, stats.collisions);
+    }
+    {
+        PerfScope scope(perfCounters.get(), stats.respawn);
+        for (unsigned int i : expired)
+        {
+            respawn(particles[i]);
+        }
+    }
+
+    stats.steps++;
+    stats.particleSteps += particles.size();
+    stats.respawns += expired.size();
 }
 
 /**
  * @brief Renders the particle system.
  * 
- * This function uses the OpenGL shader program to render each particle in the particle system.
- * It sets the necessary uniform variables for size, color, offset, and texture, and then draws
- * the particles using the specified vertex array object (VAO) and texture.
+ * All particles are drawn with a single instanced draw call. Each frame the
+ * position, size, color, age and sprite atlas layer of every particle are packed
+ * in the configured InstanceLayout into the instance buffer, which is orphaned
+ * before the upload so the driver doesn't stall on the previous frame's draw.
  * 
  * The function performs the following steps:
- * 1. Uses the shader program specified by `programID`.
- * 2. Retrieves the locations of the uniform variables for size, color, offset, and texture.
- * 3. Binds the vertex array object (VAO) and enables the vertex attribute array.
- * 4. Iterates over each particle in the `particles` container and sets the uniform variables
- *    for size, color, offset, and texture.
- * 5. Activates the texture unit and binds the texture.
- * 6. Draws the particle using `glDrawArrays` with the `GL_TRIANGLES` mode.
- * 7. Disables the vertex attribute array and unbinds the vertex array object (VAO).
+ * 1. Fills `instances` from `particles`, picking the flipbook frame from each particle's age.
+ * 2. Uploads the instances into `instancebuffer`.
+ * 3. Uses the shader program specified by `programID` and binds the texture, or the
+ *    atlas array texture, to unit 0.
+ * 4. Draws every particle with `glDrawElementsInstanced` on the shared unit cube.
  */
 void ParticleSystem::render()
 {
+    switch (config.instanceLayout)
+    {
+    case INSTANCE_FLOAT:
+        packInstances<FloatInstance>();
+        break;
+    case INSTANCE_HALF:
+        packInstances<HalfInstance>();
+        break;
+    default:
+        packInstances<CompactInstance>();
+        break;
+    }
 
     glUseProgram(programID);
 
-    GLuint sizeLocation = glGetUniformLocation(programID, "SIZE");
-    // printf("Size Location: %d\n", sizeLocation);
-    GLuint colorLocation = glGetUniformLocation(programID, "color");
-    // printf("Color Location: %d\n", colorLocation);
-    GLuint offsetLocation = glGetUniformLocation(programID, "OF");
-    // printf("Offset Location: %d\n", offsetLocation);
     GLuint textureLocation = glGetUniformLocation(programID, "Texture");
     // printf("Texture Location: %d\n", textureLocation);
 
     glBindVertexArray(VAO);
-    glEnableVertexAttribArray(0);
 
-    for (const Particle &p : particles)
-    {
+    glBindBuffer(GL_ARRAY_BUFFER, instancebuffer);
+    glBufferData(GL_ARRAY_BUFFER, instances.size(), NULL, GL_STREAM_DRAW);
+    glBufferSubData(GL_ARRAY_BUFFER, 0, instances.size(), instances.data());
 
-        glUniform1f(sizeLocation, p.size);
-        glUniform4fv(colorLocation, 1, &p.color[0]);
-        glUniform3fv(offsetLocation, 1, &p.position[0]);
-        glUniform1i(textureLocation, 0);
+    glUniform1i(textureLocation, 0);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(atlas ? GL_TEXTURE_2D_ARRAY : GL_TEXTURE_2D, textureID);
+    glUniform1i(glGetUniformLocation(programID, "LifeCurves"), 1);
+    glActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_1D_ARRAY, lifeCurveTexture);
+    glActiveTexture(GL_TEXTURE0);
+    glDrawElementsInstanced(mesh->mode, mesh->indexCount, GL_UNSIGNED_SHORT, (void *)0, (GLsizei)particles.size());
 
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, textureID);
-        glDrawArrays(GL_TRIANGLES, 0, 36);
-    }
-
-    glDisableVertexAttribArray(0);
     glBindVertexArray(0);
 }
 
+/**
+ * @brief Packs every particle into `instances` in one instance layout.
+ */
+template <typename Instance>
+void ParticleSystem::packInstances()
+{
+    instances.resize(particles.size() * sizeof(Instance));
+    Instance *out = (Instance *)instances.data();
+    for (size_t i = 0; i < particles.size(); i++)
+    {
+        const Particle &p = particles[i];
+        float age = 1.0f - p.lifetime / p.maxLifetime;
+        packInstance(out[i], p.position, p.size, p.color, age, atlas ? atlas->layer(p.sprite, age) : 0);
+    }
+}
+
 /**
  * @brief Respawns a particle with randomized properties.
  * 
@@ -176,14 +315,16 @@ void ParticleSystem::render()
  * to new randomized values within specified ranges. The particle's velocity is generated
  * using a spherical random distribution and is adjusted to ensure a positive z-component.
  * The color is set to a random shade of red, the size is set to a small random value, and
- * the lifetime is set to a random duration between 2.0 and 3.0 seconds.
+ * the lifetime is set to a random duration between 2.0 and 3.0 seconds. With an atlas,
+ * the particle also picks one of its sprites at random. Fluid particles instead drop
+ * in at rest just above the spawn block, blue, and don't age. Bodies start on a
+ * disc, moving on roughly circular orbits about its centre, and don't age either.
+ * Boids start anywhere in their region, flying level in a random direction.
  * 
  * @param p Reference to the particle to be respawned.
  */
 void ParticleSystem::respawn(Particle &p)
 {
-    p.position = glm::vec3(0.0f, 0.0f, 0.0f);
-    p.acceleration2 = glm::vec3(0.0f, 0.0f, -2.8f);
     do
     {
         p.velocity = glm::sphericalRand(glm::linearRand(0.5f, 12.5f));
@@ -200,7 +341,164 @@ void ParticleSystem::respawn(Particle &p)
     // p.color = glm::vec4(1.0f, 1.0f, 1.0f, 1.0f);
 
     p.size = glm::linearRand(0.01f, 0.03f);
+    // Just clear of the floor, so a fresh particle doesn't count as a contact
+    p.position = glm::vec3(0.0f, 0.0f, p.size);
 
     // p.size = glm::linearRand(0.2f, 0.5f);
     p.lifetime = glm::linearRand(2.0f, 3.0f);
-}
\ No newline at end of file
+    p.maxLifetime = p.lifetime;
+    int sprites = atlas ? (int)atlas->sequences().size() : 1;
+    p.sprite = std::min(sprites - 1, (int)glm::linearRand(0.0f, (float)sprites));
+
+    if (config.mode == SIM_SPH)
+    {
+        const SphParams &sph = config.sph;
+        p.position = glm::linearRand(glm::vec3(sph.spawnMin.x, sph.spawnMin.y, sph.spawnMax.z),
+                                     sph.spawnMax + glm::vec3(0.0f, 0.0f, sph.smoothingRadius));
+        p.velocity = glm::vec3(0.0f);
+        p.color = glm::vec4(glm::linearRand(0.1f, 0.2f), glm::linearRand(0.4f, 0.6f), 1.0f, 1.0f);
+        p.size = sph.spacing() * 0.6f;
+        // The age stays near zero, so the curves over life hold their starting values
+        p.lifetime = 1e9f;
+        p.maxLifetime = p.lifetime;
+    }
+    else if (config.mode == SIM_NBODY)
+    {
+        const NBodyParams &nbody = config.nbody;
+        // Uniform over the disc area, so the mass inside radius r grows with r squared
+        float fraction = std::sqrt(glm::linearRand(0.0f, 1.0f));
+        float radius = std::max(fraction * nbody.discRadius, nbody.softening);
+        float angle = glm::linearRand(0.0f, 6.2831853f);
+        glm::vec3 outward(std::cos(angle), std::sin(angle), 0.0f);
+        p.position = outward * radius;
+        p.position.z = nbody.discHeight + glm::gaussRand(0.0f, 0.02f * nbody.discRadius);
+        float speed = std::sqrt(nbody.gravity * nbody.totalMass * fraction * fraction / radius);
+        p.velocity = glm::vec3(-outward.y, outward.x, 0.0f) * speed;
+        p.color = glm::mix(glm::vec4(1.0f, 0.9f, 0.7f, 1.0f), glm::vec4(0.5f, 0.6f, 1.0f, 1.0f), fraction);
+        p.size = glm::linearRand(0.01f, 0.02f);
+        p.lifetime = 1e9f;
+        p.maxLifetime = p.lifetime;
+    }
+    else if (config.mode == SIM_BOIDS)
+    {
+        const BoidParams &boids = config.boids;
+        p.position = glm::linearRand(boids.regionMin, boids.regionMax);
+        float heading = glm::linearRand(0.0f, 6.2831853f);
+        p.velocity = glm::vec3(std::cos(heading), std::sin(heading), 0.0f) * glm::linearRand(boids.minSpeed, boids.maxSpeed);
+        p.color = glm::vec4(glm::linearRand(0.1f, 0.25f), glm::linearRand(0.1f, 0.25f), glm::linearRand(0.2f, 0.35f), 1.0f);
+        p.size = glm::linearRand(0.02f, 0.03f);
+        p.lifetime = 1e9f;
+        p.maxLifetime = p.lifetime;
+    }
+}
+
+/**
+ * @brief Switches to the shader variant specialized for the given features.
+ *
+ * The variant is built on first use and cached, so switching back is free.
+ *
+ * @param features Bitwise OR of ShaderFeature values.
+ */
+void ParticleSystem::setShaderFeatures(unsigned int features)
+{
+    const ShaderVariant *variant = ShaderVariants::instance().get(shader->vertexPath, shader->fragmentPath, features);
+    if (variant->program == 0)
+    {
+        std::cerr << "Keeping current shader; variant " << features << " failed to build" << std::endl;
+        return;
+    }
+    shader = variant;
+    shaderFeatures = features;
+    programID = shader->program;
+}
+
+/**
+ * @brief Turns hardware counter sampling of update() on or off.
+ *
+ * The thread pool's workers are counted along with the calling thread, since the
+ * parallel passes, such as the neighbour grid build, run mostly on them.
+ * Sampling stays off, with a message, if the platform or kernel does not allow it.
+ *
+ * @param enable Whether to sample the update and respawn passes.
+ */
+void ParticleSystem::enablePerfCounters(bool enable)
+{
+    if (!enable)
+    {
+        perfCounters.reset();
+        return;
+    }
+    perfCounters.reset(new PerfCounters(ThreadPool::shared().threadIds()));
+    if (!perfCounters->available())
+    {
+        perfCounters.reset();
+    }
+}
+
+/**
+ * @brief Prints the work counters gathered by update().
+ *
+ * Hardware counters are reported per particle: per updated particle for the
+ * integration pass and per respawned particle for the respawn pass.
+ */
+void ParticleSystem::printStatus()
+{
+    std::cout << "Particles: " << particles.size() << "/" << numParticles
+              << ", steps: " << stats.steps
+              << ", respawns: " << stats.respawns << std::endl;
+
+    if (config.mode == SIM_SPH)
+        printf("  sph: smoothing radius %.3f, particle mass %.4f, mean density %.1f (rest %.1f)\n",
+               config.sph.smoothingRadius, config.sph.particleMass(), sph.averageDensity(), config.sph.restDensity);
+    if (config.mode == SIM_NBODY)
+        printf("  nbody: theta %.2f, softening %.3f, %zu tree nodes, depth %u\n", config.nbody.theta,
+               config.nbody.softening, tree.nodeCount(), tree.depth());
+    if (config.mode == SIM_BOIDS)
+        printf("  boids: perception radius %.2f, at most %u neighbours\n", config.boids.perceptionRadius,
+               config.boids.maxNeighbors);
+
+    if (!config.colliders.empty())
+        printf("  colliders %zu, contacts %llu, kills %llu, passes %llu run, %llu skipped by broad phase\n",
+               config.colliders.size(), stats.collisions.contacts, stats.collisions.kills,
+               stats.collisions.tested, stats.collisions.skipped);
+
+    GLsizei stride = instanceStride(config.instanceLayout);
+    printf("  instances: %s layout, %d bytes/particle, %.2f MiB uploaded per frame\n",
+           instanceLayoutName(config.instanceLayout), (int)stride, particles.size() * stride / 1048576.0);
+
+    TextureStats textures = TextureManager::instance().stats();
+    printf("  textures %u (%u referenced, %u streaming), %.2f MiB of %.2f MiB budget (%.2f MiB referenced), hits %llu, misses %llu, evictions %llu\n",
+           textures.textures, textures.referenced, textures.pending, textures.bytes / 1048576.0,
+           textures.budget / 1048576.0, textures.referencedBytes / 1048576.0,
+           textures.hits, textures.misses, textures.evictions);
+
+    struct Region
+    {
+        const char *name;
+        const PerfSample &sample;
+        unsigned long long count;
+        bool enabled;
+    } regions[] = {
+        {"update", stats.update, stats.particleSteps, true},
+        {"respawn", stats.respawn, stats.respawns, true},
+        {"collide", stats.collide, stats.particleSteps, !config.colliders.empty()},
+        {"grid", stats.grid, stats.particleSteps, config.neighborRadius > 0.0f},
+        {"sph", stats.sph, stats.particleSteps, config.mode == SIM_SPH},
+        {"nbody", stats.nbody, stats.particleSteps, config.mode == SIM_NBODY},
+        {"boids", stats.boids, stats.particleSteps, config.mode == SIM_BOIDS},
+    };
+    for (const Region &region : regions)
+    {
+        if (!region.enabled)
+            continue;
+        if (region.sample.runs == 0 || region.count == 0)
+        {
+            std::cout << "  " << region.name << ": no counter data" << std::endl;
+            continue;
+        }
+        double n = (double)region.count;
+        printf("  %-8s cycles/particle %.2f, instructions/particle %.2f, IPC %.2f, LLC misses/particle %.4f, branch misses/particle %.4f\n",
+               region.name, region.sample.cycles / n, region.sample.instructions / n, region.sample.ipc(),
+               region.sample.cacheMisses / n, region.sample.branchMisses / n);
+    }
+}
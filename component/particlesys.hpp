@@ -2,131 +2,140 @@
 #define PARTICLESYS_HPP
 
 #include <iostream>
+#include <memory>
 #include <vector>
 #include <glm/glm.hpp>
 #include <glm/gtc/random.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <GL/glew.h>
 #include "shader.hpp"
+#include "shadervariants.hpp"
 #include "texture.hpp"
+#include "texturemanager.hpp"
+#include "spritegen.hpp"
+#include "spriteatlas.hpp"
+#include "geometry.hpp"
+#include "instancelayout.hpp"
+#include "lifecurves.hpp"
+#include "forcefield.hpp"
+#include "collider.hpp"
+#include "spatialgrid.hpp"
+#include "sph.hpp"
+#include "barneshut.hpp"
+#include "boids.hpp"
+#include "perfcounters.hpp"
 
 struct Particle
 {
     glm::vec3 position;
-    glm::vec3 acceleration1;
-    glm::vec3 acceleration2;
     glm::vec3 velocity;
     glm::vec4 color;
     GLfloat lifetime;
+    GLfloat maxLifetime; // Lifetime at respawn, for the normalized age
     GLfloat size;
+    int sprite; // Sequence in the sprite atlas
+};
+
+
+/**
+ * @brief How update() moves the particles. Every mode renders through the same instanced path.
+ */
+enum SimulationMode
+{
+    SIM_SPRITES, // Independent particles under the force modules, respawned when their life ends
+    SIM_SPH,     // A fluid: particles push on their neighbours and live until a kill collider takes them
+    SIM_NBODY,   // Self-gravitating bodies, starting as a rotating disc; they live until a kill collider takes them
+    SIM_BOIDS,   // A flock steering by its neighbours and around the colliders; boids live until a kill collider takes them
+};
+
+/**
+ * @brief Emitter settings chosen at construction.
+ */
+struct EmitterConfig
+{
+    SimulationMode mode = SIM_SPRITES;
+    std::string spritePath; // Image file for the sprite, or a still sprite added to the atlas; empty to generate one
+    SpriteParams sprite;
+    QualityLevel quality = QUALITY_MEDIUM; // Picks the generated sprite resolution
+    std::vector<SpriteParams> atlasSprites; // When not empty, packed into an atlas; each particle picks one
+    int flipbookFrames = 1;                 // Frames per atlas sprite, played over each particle's life
+    InstanceLayout instanceLayout = INSTANCE_COMPACT; // Encoding of the per-particle data uploaded each frame
+    LifeCurves curves = LifeCurves::fade();           // Color, alpha and size over life, applied on the GPU
+    std::vector<ForceField> forces = {ForceField::gravity(glm::vec3(0.0f, 0.0f, -2.8f))}; // Applied in order
+    std::vector<Collider> colliders; // Resolved after integration; the scene floor is usually one of them
+    float neighborRadius = 0.0f;     // When positive, a SpatialGrid of this cell size is rebuilt every step
+    SphParams sph;                   // Fluid settings for SIM_SPH
+    NBodyParams nbody;               // Gravity settings for SIM_NBODY
+    BoidParams boids;                // Flocking settings for SIM_BOIDS
+};
+
+/**
+ * @brief Work counters for a ParticleSystem, filled in by update().
+ *
+ * The hardware counter samples stay empty unless enablePerfCounters() was called
+ * and the kernel allows counting. They sum the calling thread and the thread
+ * pool's workers, so per-particle costs include the parallel passes.
+ */
+struct ParticleStats
+{
+    unsigned long long steps = 0;
+    unsigned long long particleSteps = 0;
+    unsigned long long respawns = 0;
+    CollisionCounts collisions;
+    PerfSample update;
+    PerfSample respawn;
+    PerfSample collide;
+    PerfSample grid;
+    PerfSample sph;
+    PerfSample nbody;
+    PerfSample boids;
 };
 
 class ParticleSystem
 {
 public:
     GLuint programID;
+    const ShaderVariant *shader;
+    unsigned int shaderFeatures;
+    TextureHandle texture;
+    std::unique_ptr<SpriteAtlas> atlas;
     GLuint textureID;
+    GLuint lifeCurveTexture = 0;
 
-    GLuint VAO;
-    GLuint vertexbuffer;
-    // GLfloat g_vertex_buffer_data[108];
-    GLfloat g_vertex_buffer_data[108] = {
-        // Front face
-        -1.0f, -1.0f, 1.0f,
-        1.0f, -1.0f, 1.0f,
-        1.0f, 1.0f, 1.0f,
-        -1.0f, -1.0f, 1.0f,
-        1.0f, 1.0f, 1.0f,
-        -1.0f, 1.0f, 1.0f,
-        // Back face
-        -1.0f, -1.0f, -1.0f,
-        -1.0f, 1.0f, -1.0f,
-        1.0f, 1.0f, -1.0f,
-        -1.0f, -1.0f, -1.0f,
-        1.0f, 1.0f, -1.0f,
-        1.0f, -1.0f, -1.0f,
-        // Left face
-        -1.0f, -1.0f, -1.0f,
-        -1.0f, -1.0f, 1.0f,
-        -1.0f, 1.0f, 1.0f,
-        -1.0f, -1.0f, -1.0f,
-        -1.0f, 1.0f, 1.0f,
-        -1.0f, 1.0f, -1.0f,
-        // Right face
-        1.0f, -1.0f, -1.0f,
-        1.0f, 1.0f, -1.0f,
-        1.0f, 1.0f, 1.0f,
-        1.0f, -1.0f, -1.0f,
-        1.0f, 1.0f, 1.0f,
-        1.0f, -1.0f, 1.0f,
-        // Top face
-        -1.0f, 1.0f, -1.0f,
-        -1.0f, 1.0f, 1.0f,
-        1.0f, 1.0f, 1.0f,
-        -1.0f, 1.0f, -1.0f,
-        1.0f, 1.0f, 1.0f,
-        1.0f, 1.0f, -1.0f,
-        // Bottom face
-        -1.0f, -1.0f, -1.0f,
-        1.0f, -1.0f, -1.0f,
-        1.0f, -1.0f, 1.0f,
-        -1.0f, -1.0f, -1.0f,
-        1.0f, -1.0f, 1.0f,
-        -1.0f, -1.0f, 1.0f};
-    GLfloat g_uv_buffer_data[72] = {
-        // Front face
-        0.0f, 0.0f,
-        1.0f, 0.0f,
-        1.0f, 1.0f,
-        0.0f, 0.0f,
-        1.0f, 1.0f,
-        0.0f, 1.0f,
-        // Back face
-        0.0f, 0.0f,
-        0.0f, 1.0f,
-        1.0f, 1.0f,
-        0.0f, 0.0f,
-        1.0f, 1.0f,
-        1.0f, 0.0f,
-        // Left face
-        0.0f, 0.0f,
-        1.0f, 0.0f,
-        1.0f, 1.0f,
-        0.0f, 0.0f,
-        1.0f, 1.0f,
-        0.0f, 1.0f,
-        // Right face
-        0.0f, 0.0f,
-        0.0f, 1.0f,
-        1.0f, 1.0f,
-        0.0f, 0.0f,
-        1.0f, 1.0f,
-        1.0f, 0.0f,
-        // Top face
-        0.0f, 0.0f,
-        0.0f, 1.0f,
-        1.0f, 1.0f,
-        0.0f, 0.0f,
-        1.0f, 1.0f,
-        1.0f, 0.0f,
-        // Bottom face
-        0.0f, 0.0f,
-        1.0f, 0.0f,
-        1.0f, 1.0f,
-        0.0f, 0.0f,
-        1.0f, 1.0f,
-        0.0f, 1.0f};
+    GLuint VAO = 0;
+    GLuint instancebuffer = 0;
+    const Mesh *mesh = nullptr;
 
     std::vector<Particle> particles;
 
     unsigned int numParticles;
+    EmitterConfig config;
+    float time = 0.0f; // Simulated seconds, for animated force fields
+
+    ParticleStats stats;
+    std::unique_ptr<PerfCounters> perfCounters;
+    std::vector<unsigned int> expired;
+    std::vector<unsigned char> instances; // Packed in config.instanceLayout
+    SpatialGrid grid;                     // Neighbours within config.neighborRadius, in particle order
+    std::vector<Particle> reordered;      // Scratch for sorting particles into grid order
+    SphSolver sph;
+    BarnesHutTree tree; // Rebuilt every step in SIM_NBODY
+    BoidFlock flock;
 
-    ParticleSystem(unsigned int amount);
+    ParticleSystem(unsigned int amount, const EmitterConfig &config = EmitterConfig());
+    ~ParticleSystem();
     void emit();
     void respawn(Particle &p);
     void update(float dt);
     void render();
+    template <typename Instance>
+    void packInstances();
+    void setShaderFeatures(unsigned int features);
+    void enablePerfCounters(bool enable);
     void printStatus();
+
+private:
+    void step(float dt);
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,176 @@
+#include "perfcounters.hpp"
+
+#include <cstdio>
+#include <cstring>
+
+#ifdef __linux__
+#include <cerrno>
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace
+{
+    int openCounter(uint32_t type, uint64_t config, long thread, int groupFd)
+    {
+        perf_event_attr attr;
+        memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = type;
+        attr.config = config;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+        return (int)syscall(SYS_perf_event_open, &attr, (pid_t)thread, -1, groupFd, 0);
+    }
+}
+
+/**
+ * @brief Opens the counter group for the calling thread, then one for each of threads.
+ *
+ * @param threads Kernel thread ids, such as ThreadPool::threadIds(); zeros are skipped.
+ */
+PerfCounters::PerfCounters(const std::vector<long> &threads) : groups(1)
+{
+    for (int i = 0; i < COUNTER_COUNT; i++)
+        startValues[i] = 0;
+    if (!open(groups[0], 0))
+    {
+        fprintf(stderr, "Hardware counters unavailable (%s); check /proc/sys/kernel/perf_event_paranoid\n", strerror(errno));
+        return;
+    }
+    for (long thread : threads)
+    {
+        Group group;
+        if (thread != 0 && open(group, thread))
+            groups.push_back(group);
+    }
+}
+
+PerfCounters::~PerfCounters()
+{
+    for (const Group &group : groups)
+        for (int i = 0; i < COUNTER_COUNT; i++)
+        {
+            if (group.fds[i] >= 0)
+                close(group.fds[i]);
+        }
+}
+
+/**
+ * @brief Opens one thread's counters, 0 meaning the calling thread.
+ *
+ * Cycles leads the group; the other counters are optional and are simply
+ * reported as missing when the PMU does not expose them.
+ */
+bool PerfCounters::open(Group &group, long thread)
+{
+    for (int i = 0; i < COUNTER_COUNT; i++)
+        group.fds[i] = -1;
+    group.fds[CYCLES] = openCounter(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES, thread, -1);
+    if (group.fds[CYCLES] < 0)
+        return false;
+    group.fds[INSTRUCTIONS] = openCounter(PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS, thread, group.fds[CYCLES]);
+    group.fds[CACHE_MISSES] = openCounter(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES, thread, group.fds[CYCLES]);
+    group.fds[BRANCH_MISSES] = openCounter(PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES, thread, group.fds[CYCLES]);
+    return true;
+}
+
+/**
+ * @brief Reads one group in one syscall, scaling for multiplexing.
+ *
+ * Counters that failed to open are reported as zero.
+ */
+bool PerfCounters::read(const Group &group, uint64_t values[COUNTER_COUNT])
+{
+    // nr, time_enabled, time_running, then one value per opened counter in open order
+    uint64_t buffer[3 + COUNTER_COUNT];
+    if (::read(group.fds[CYCLES], buffer, sizeof(buffer)) <= 0)
+        return false;
+
+    uint64_t enabled = buffer[1];
+    uint64_t running = buffer[2];
+    uint64_t next = 3;
+    for (int i = 0; i < COUNTER_COUNT; i++)
+    {
+        values[i] = 0;
+        if (group.fds[i] < 0 || next >= 3 + buffer[0])
+            continue;
+        values[i] = buffer[next++];
+        if (running && running < enabled)
+            values[i] = (uint64_t)((double)values[i] * enabled / running);
+    }
+    return true;
+}
+
+/**
+ * @brief Sums every thread's counters. Fails only if the calling thread's can't be read.
+ */
+bool PerfCounters::read(uint64_t values[COUNTER_COUNT])
+{
+    if (!read(groups[0], values))
+        return false;
+    for (size_t g = 1; g < groups.size(); g++)
+    {
+        uint64_t thread[COUNTER_COUNT];
+        if (!read(groups[g], thread))
+            continue;
+        for (int i = 0; i < COUNTER_COUNT; i++)
+            values[i] += thread[i];
+    }
+    return true;
+}
+#else
+PerfCounters::PerfCounters(const std::vector<long> &) : groups(1)
+{
+    for (int i = 0; i < COUNTER_COUNT; i++)
+    {
+        groups[0].fds[i] = -1;
+        startValues[i] = 0;
+    }
+}
+
+PerfCounters::~PerfCounters()
+{
+}
+
+bool PerfCounters::open(Group &, long)
+{
+    return false;
+}
+
+bool PerfCounters::read(const Group &, uint64_t *)
+{
+    return false;
+}
+
+bool PerfCounters::read(uint64_t *)
+{
+    return false;
+}
+#endif
+
+/**
+ * @brief Starts an instrumented region.
+ */
+void PerfCounters::begin()
+{
+    if (available())
+        read(startValues);
+}
+
+/**
+ * @brief Ends an instrumented region and adds its counts to the sample.
+ */
+void PerfCounters::end(PerfSample &sample)
+{
+    uint64_t values[COUNTER_COUNT];
+    if (!available() || !read(values))
+        return;
+
+    sample.cycles += values[CYCLES] - startValues[CYCLES];
+    sample.instructions += values[INSTRUCTIONS] - startValues[INSTRUCTIONS];
+    sample.cacheMisses += values[CACHE_MISSES] - startValues[CACHE_MISSES];
+    sample.branchMisses += values[BRANCH_MISSES] - startValues[BRANCH_MISSES];
+    sample.runs++;
+}
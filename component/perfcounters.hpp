@@ -0,0 +1,98 @@
+#ifndef PERFCOUNTERS_HPP
+#define PERFCOUNTERS_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+ * @brief Hardware counter totals accumulated over one or more instrumented runs.
+ */
+struct PerfSample
+{
+    uint64_t cycles = 0;
+    uint64_t instructions = 0;
+    uint64_t cacheMisses = 0;
+    uint64_t branchMisses = 0;
+    uint64_t runs = 0;
+
+    double ipc() const { return cycles ? (double)instructions / cycles : 0.0; }
+};
+
+/**
+ * @brief Reads CPU cycles, instructions, last-level cache misses and branch misses
+ * for the calling thread, and any extra threads given, through Linux perf_event_open.
+ *
+ * Each thread gets its own counter group and every read sums them, so a region
+ * that hands work to ThreadPool workers is charged for all of it. Workers also
+ * run background jobs, which land in whatever region is open at the time.
+ *
+ * Opening fails quietly (after one message) when the kernel refuses access, e.g.
+ * because of perf_event_paranoid, inside most VMs, or on other platforms. The
+ * object then stays usable and every measurement is a no-op. An extra thread
+ * whose counters cannot be opened is left out.
+ */
+class PerfCounters
+{
+public:
+    enum Counter
+    {
+        CYCLES,
+        INSTRUCTIONS,
+        CACHE_MISSES,
+        BRANCH_MISSES,
+        COUNTER_COUNT
+    };
+
+    explicit PerfCounters(const std::vector<long> &threads = std::vector<long>());
+    ~PerfCounters();
+
+    PerfCounters(const PerfCounters &) = delete;
+    PerfCounters &operator=(const PerfCounters &) = delete;
+
+    bool available() const { return groups[0].fds[CYCLES] >= 0; }
+    bool has(Counter counter) const { return groups[0].fds[counter] >= 0; }
+    size_t threadCount() const { return groups.size(); }
+
+    void begin();
+    void end(PerfSample &sample);
+
+private:
+    struct Group
+    {
+        int fds[COUNTER_COUNT];
+    };
+
+    bool open(Group &group, long thread);
+    bool read(const Group &group, uint64_t values[COUNTER_COUNT]);
+    bool read(uint64_t values[COUNTER_COUNT]);
+
+    std::vector<Group> groups; // The calling thread's first
+    uint64_t startValues[COUNTER_COUNT];
+};
+
+/**
+ * @brief Adds the counters for the enclosing scope to a PerfSample.
+ *
+ * @param counters Counter group to read, or null to measure nothing.
+ */
+class PerfScope
+{
+public:
+    PerfScope(PerfCounters *counters, PerfSample &sample) : counters(counters), sample(sample)
+    {
+        if (counters)
+            counters->begin();
+    }
+    ~PerfScope()
+    {
+        if (counters)
+            counters->end(sample);
+    }
+
+private:
+    PerfCounters *counters;
+    PerfSample &sample;
+};
+
+#endif
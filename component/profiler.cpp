@@ -0,0 +1,172 @@
+#include "profiler.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <vector>
+
+namespace
+{
+    struct TraceEvent
+    {
+        const char *name;
+        uint64_t start;
+        uint64_t end;
+    };
+
+    // Events are stored in fixed-size chunks so that a full buffer never moves
+    // events the flushing thread may be reading.
+    struct EventChunk
+    {
+        static const unsigned int capacity = 4096;
+
+        TraceEvent events[capacity];
+        std::atomic<unsigned int> count{0};
+        std::atomic<EventChunk *> next{nullptr};
+    };
+
+    // One buffer per thread. Only the owning thread writes to it; the writer
+    // publishes each event with a release store of the chunk count.
+    struct ThreadBuffer
+    {
+        unsigned int threadID;
+        char threadName[32];
+        EventChunk *head;
+        EventChunk *tail;
+        ThreadBuffer *next;
+    };
+
+    const std::chrono::steady_clock::time_point processStart = std::chrono::steady_clock::now();
+    std::atomic<ThreadBuffer *> threadBuffers{nullptr};
+    std::atomic<unsigned int> nextThreadID{1};
+    std::mutex threadNameMutex; // Names can change while writeTrace() reads them
+
+    /**
+     * @brief Returns the calling thread's buffer, registering it on first use.
+     *
+     * Buffers are pushed onto a lock-free list and are never freed, so events
+     * recorded by worker threads survive until the trace is written.
+     */
+    ThreadBuffer *threadBuffer()
+    {
+        thread_local ThreadBuffer *buffer = nullptr;
+        if (buffer == nullptr)
+        {
+            buffer = new ThreadBuffer();
+            buffer->threadID = nextThreadID.fetch_add(1);
+            snprintf(buffer->threadName, sizeof(buffer->threadName), "thread %u", buffer->threadID);
+            buffer->head = buffer->tail = new EventChunk();
+            buffer->next = threadBuffers.load(std::memory_order_relaxed);
+            while (!threadBuffers.compare_exchange_weak(buffer->next, buffer, std::memory_order_release, std::memory_order_relaxed))
+            {
+            }
+        }
+        return buffer;
+    }
+
+    void writeEscaped(FILE *file, const char *text)
+    {
+        for (; *text; text++)
+        {
+            if (*text == '"' || *text == '\\')
+                fputc('\\', file);
+            fputc(*text, file);
+        }
+    }
+}
+
+/**
+ * @brief Returns the current time in nanoseconds since the process started.
+ */
+uint64_t Profiler::now()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - processStart).count();
+}
+
+/**
+ * @brief Appends a complete event to the calling thread's buffer.
+ *
+ * @param name Event name. The pointer is stored, not copied.
+ * @param start Start time from Profiler::now().
+ * @param end End time from Profiler::now().
+ */
+void Profiler::record(const char *name, uint64_t start, uint64_t end)
+{
+    ThreadBuffer *buffer = threadBuffer();
+    EventChunk *chunk = buffer->tail;
+    unsigned int index = chunk->count.load(std::memory_order_relaxed);
+    if (index == EventChunk::capacity)
+    {
+        EventChunk *fresh = new EventChunk();
+        chunk->next.store(fresh, std::memory_order_release);
+        buffer->tail = chunk = fresh;
+        index = 0;
+    }
+    chunk->events[index] = TraceEvent{name, start, end};
+    chunk->count.store(index + 1, std::memory_order_release);
+}
+
+/**
+ * @brief Names the calling thread in the trace viewer.
+ */
+void Profiler::setThreadName(const char *name)
+{
+    ThreadBuffer *buffer = threadBuffer();
+    std::lock_guard<std::mutex> lock(threadNameMutex);
+    snprintf(buffer->threadName, sizeof(buffer->threadName), "%s", name);
+}
+
+/**
+ * @brief Writes every event recorded so far as Chrome trace event JSON.
+ *
+ * Safe to call while other threads are still recording; events published
+ * after a chunk has been visited are simply not included.
+ *
+ * @param path Output file path.
+ * @return true if the file was written.
+ */
+bool Profiler::writeTrace(const char *path)
+{
+    FILE *file = fopen(path, "w");
+    if (!file)
+    {
+        fprintf(stderr, "Failed to open trace file %s\n", path);
+        return false;
+    }
+
+    fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+    bool first = true;
+    size_t total = 0;
+    for (ThreadBuffer *buffer = threadBuffers.load(std::memory_order_acquire); buffer; buffer = buffer->next)
+    {
+        fprintf(file, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"",
+                first ? "" : ",\n", buffer->threadID);
+        {
+            std::lock_guard<std::mutex> lock(threadNameMutex);
+            writeEscaped(file, buffer->threadName);
+        }
+        fprintf(file, "\"}}");
+        first = false;
+
+        for (EventChunk *chunk = buffer->head; chunk; chunk = chunk->next.load(std::memory_order_acquire))
+        {
+            unsigned int count = chunk->count.load(std::memory_order_acquire);
+            for (unsigned int i = 0; i < count; i++)
+            {
+                const TraceEvent &event = chunk->events[i];
+                fprintf(file, ",\n{\"name\":\"");
+                writeEscaped(file, event.name);
+                fprintf(file, "\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}",
+                        buffer->threadID, event.start / 1000.0, (event.end - event.start) / 1000.0);
+            }
+            total += count;
+        }
+    }
+    fprintf(file, "\n]}\n");
+    fclose(file);
+
+    printf("Profiler: wrote %zu events to %s\n", total, path);
+    return true;
+}
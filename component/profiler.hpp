@@ -0,0 +1,56 @@
+#ifndef PROFILER_HPP
+#define PROFILER_HPP
+
+#include <cstdint>
+
+/**
+ * @brief Scoped CPU profiler that writes Chrome trace event JSON.
+ *
+ * Every thread records into its own append-only buffer, so recording never
+ * takes a lock. The trace is written once with writeTrace() and can be opened
+ * in chrome://tracing or https://ui.perfetto.dev.
+ *
+ * Use the PROFILE_* macros rather than the class directly: they compile to
+ * nothing unless the build defines ENABLE_PROFILER (cmake -DPROFILER=ON).
+ */
+class Profiler
+{
+public:
+    static uint64_t now();
+    static void record(const char *name, uint64_t start, uint64_t end);
+    static void setThreadName(const char *name);
+    static bool writeTrace(const char *path);
+};
+
+/**
+ * @brief Records the lifetime of the enclosing scope as one trace event.
+ *
+ * @param name Event name. Must be a string literal (or otherwise outlive the trace).
+ */
+class ProfileScope
+{
+public:
+    explicit ProfileScope(const char *name) : name(name), start(Profiler::now()) {}
+    ~ProfileScope() { Profiler::record(name, start, Profiler::now()); }
+
+    ProfileScope(const ProfileScope &) = delete;
+    ProfileScope &operator=(const ProfileScope &) = delete;
+
+private:
+    const char *name;
+    uint64_t start;
+};
+
+#ifdef ENABLE_PROFILER
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+#define PROFILE_SCOPE(name) ProfileScope PROFILE_CONCAT(profileScope_, __LINE__)(name)
+#define PROFILE_THREAD_NAME(name) Profiler::setThreadName(name)
+#define PROFILE_WRITE_TRACE(path) Profiler::writeTrace(path)
+#else
+#define PROFILE_SCOPE(name) ((void)0)
+#define PROFILE_THREAD_NAME(name) ((void)0)
+#define PROFILE_WRITE_TRACE(path) ((void)0)
+#endif
+
+#endif
@@ -0,0 +1,294 @@
+#include "programcache.hpp"
+#include "profiler.hpp"
+
+#include <stdio.h>
+#include <filesystem>
+
+namespace
+{
+    const uint32_t binaryMagic = 0x4E494250; // "PBIN"
+
+    struct BinaryHeader
+    {
+        uint32_t magic;
+        uint32_t format;
+        uint64_t key;
+        uint64_t length;
+    };
+
+    uint64_t fnv1a(uint64_t hash, const std::string &text)
+    {
+        for (unsigned char c : text)
+        {
+            hash ^= c;
+            hash *= 1099511628211ull;
+        }
+        // Separator so ("ab", "c") and ("a", "bc") hash differently
+        hash ^= 0xFF;
+        hash *= 1099511628211ull;
+        return hash;
+    }
+
+    GLuint compileShader(GLenum type, const std::string &code, const std::string &label)
+    {
+        printf("Compiling shader : %s\n", label.c_str());
+        GLuint shaderID = glCreateShader(type);
+        char const *sourcePointer = code.c_str();
+        glShaderSource(shaderID, 1, &sourcePointer, NULL);
+        glCompileShader(shaderID);
+        return shaderID;
+    }
+
+    bool checkShader(GLuint shaderID)
+    {
+        GLint result = GL_FALSE;
+        int infoLogLength;
+        glGetShaderiv(shaderID, GL_COMPILE_STATUS, &result);
+        glGetShaderiv(shaderID, GL_INFO_LOG_LENGTH, &infoLogLength);
+        if (infoLogLength > 0)
+        {
+            std::vector<char> errorMessage(infoLogLength + 1);
+            glGetShaderInfoLog(shaderID, infoLogLength, NULL, &errorMessage[0]);
+            printf("%s\n", &errorMessage[0]);
+        }
+        return result == GL_TRUE;
+    }
+
+    bool checkProgram(GLuint programID)
+    {
+        GLint result = GL_FALSE;
+        int infoLogLength;
+        glGetProgramiv(programID, GL_LINK_STATUS, &result);
+        glGetProgramiv(programID, GL_INFO_LOG_LENGTH, &infoLogLength);
+        if (infoLogLength > 0)
+        {
+            std::vector<char> errorMessage(infoLogLength + 1);
+            glGetProgramInfoLog(programID, infoLogLength, NULL, &errorMessage[0]);
+            printf("%s\n", &errorMessage[0]);
+        }
+        return result == GL_TRUE;
+    }
+}
+
+ProgramCache::ProgramCache()
+    : directory("shader_cache"), binaryFormats(-1), parallelCompileEnabled(false)
+{
+}
+
+/**
+ * @brief Returns the process-wide cache. Must only be used on threads with a current GL context.
+ */
+ProgramCache &ProgramCache::instance()
+{
+    static ProgramCache cache;
+    return cache;
+}
+
+/**
+ * @brief Sets where program binaries are stored. An empty string disables the disk cache.
+ */
+void ProgramCache::setDirectory(const std::string &directory)
+{
+    this->directory = directory;
+}
+
+uint64_t ProgramCache::key(const ProgramSource &source)
+{
+    if (driver.empty())
+    {
+        const GLubyte *strings[] = {glGetString(GL_VENDOR), glGetString(GL_RENDERER), glGetString(GL_VERSION)};
+        for (const GLubyte *s : strings)
+        {
+            driver += s ? (const char *)s : "?";
+            driver += '\n';
+        }
+    }
+
+    uint64_t hash = 14695981039346656037ull;
+    hash = fnv1a(hash, source.vertexCode);
+    hash = fnv1a(hash, source.fragmentCode);
+    hash = fnv1a(hash, source.defines);
+    hash = fnv1a(hash, driver);
+    return hash;
+}
+
+std::string ProgramCache::binaryPath(uint64_t key) const
+{
+    char name[32];
+    snprintf(name, sizeof(name), "%016llx.bin", (unsigned long long)key);
+    return directory + "/" + name;
+}
+
+/**
+ * @brief Whether the context can save and restore program binaries at all.
+ *
+ * Some drivers (notably macOS) expose the entry points but report zero formats.
+ */
+bool ProgramCache::binariesSupported()
+{
+    if (binaryFormats < 0)
+    {
+        binaryFormats = 0;
+        if (GLEW_ARB_get_program_binary)
+            glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &binaryFormats);
+    }
+    return binaryFormats > 0 && !directory.empty();
+}
+
+/**
+ * @brief Creates a program from a cached binary.
+ *
+ * @return The linked program, or 0 on a miss or if the driver rejects the binary.
+ */
+GLuint ProgramCache::loadBinary(uint64_t key)
+{
+    FILE *file = fopen(binaryPath(key).c_str(), "rb");
+    if (!file)
+        return 0;
+
+    BinaryHeader header;
+    std::vector<char> binary;
+    bool valid = fread(&header, sizeof(header), 1, file) == 1 &&
+                 header.magic == binaryMagic && header.key == key && header.length > 0;
+    if (valid)
+    {
+        binary.resize(header.length);
+        valid = fread(binary.data(), 1, binary.size(), file) == binary.size();
+    }
+    fclose(file);
+    if (!valid)
+        return 0;
+
+    GLuint programID = glCreateProgram();
+    glProgramBinary(programID, header.format, binary.data(), (GLsizei)binary.size());
+    GLint result = GL_FALSE;
+    glGetProgramiv(programID, GL_LINK_STATUS, &result);
+    if (result != GL_TRUE)
+    {
+        // Typically a driver update; fall back to compiling and overwrite the entry
+        glDeleteProgram(programID);
+        return 0;
+    }
+    return programID;
+}
+
+void ProgramCache::storeBinary(uint64_t key, GLuint program)
+{
+    GLint length = 0;
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0)
+        return;
+
+    BinaryHeader header = {binaryMagic, 0, key, (uint64_t)length};
+    std::vector<char> binary(length);
+    GLenum format = 0;
+    glGetProgramBinary(program, length, NULL, &format, binary.data());
+    header.format = format;
+
+    std::error_code error;
+    std::filesystem::create_directories(directory, error);
+    std::string path = binaryPath(key);
+    std::string temporary = path + ".tmp";
+    FILE *file = fopen(temporary.c_str(), "wb");
+    if (!file)
+        return;
+    bool written = fwrite(&header, sizeof(header), 1, file) == 1 &&
+                   fwrite(binary.data(), 1, binary.size(), file) == binary.size();
+    fclose(file);
+    if (written)
+        std::filesystem::rename(temporary, path, error);
+    else
+        std::filesystem::remove(temporary, error);
+}
+
+/**
+ * @brief Builds a single program. See buildAll().
+ */
+GLuint ProgramCache::build(const ProgramSource &source)
+{
+    return buildAll(std::vector<ProgramSource>(1, source))[0];
+}
+
+/**
+ * @brief Builds several programs, loading cached binaries where possible.
+ *
+ * All cache misses are compiled and linked before any status is queried, so
+ * with GL_KHR_parallel_shader_compile the driver works on them concurrently.
+ *
+ * @param sources Programs to build.
+ * @return One program per source, or 0 for a program that failed to compile or link.
+ */
+std::vector<GLuint> ProgramCache::buildAll(const std::vector<ProgramSource> &sources)
+{
+    PROFILE_SCOPE("ProgramCache::buildAll");
+    std::lock_guard<std::mutex> lock(mutex);
+
+    std::vector<GLuint> programs(sources.size(), 0);
+    std::vector<uint64_t> keys(sources.size());
+    bool useBinaries = binariesSupported();
+
+    std::vector<size_t> pending;
+    for (size_t i = 0; i < sources.size(); i++)
+    {
+        keys[i] = key(sources[i]);
+        if (useBinaries)
+            programs[i] = loadBinary(keys[i]);
+        if (programs[i] != 0)
+            hits++;
+        else
+            pending.push_back(i);
+    }
+    if (pending.empty())
+        return programs;
+    misses += (unsigned int)pending.size();
+
+#ifdef GL_KHR_parallel_shader_compile
+    if (!parallelCompileEnabled && GLEW_KHR_parallel_shader_compile)
+    {
+        // Let the driver pick how many compiler threads to use
+        glMaxShaderCompilerThreadsKHR(0xFFFFFFFF);
+        parallelCompileEnabled = true;
+    }
+#endif
+
+    // Issue every compile and link first ...
+    std::vector<GLuint> vertexShaders(sources.size()), fragmentShaders(sources.size());
+    for (size_t i : pending)
+    {
+        vertexShaders[i] = compileShader(GL_VERTEX_SHADER, sources[i].vertexCode, sources[i].vertexLabel);
+        fragmentShaders[i] = compileShader(GL_FRAGMENT_SHADER, sources[i].fragmentCode, sources[i].fragmentLabel);
+    }
+    for (size_t i : pending)
+    {
+        printf("Linking program\n");
+        programs[i] = glCreateProgram();
+        if (useBinaries)
+            glProgramParameteri(programs[i], GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+        glAttachShader(programs[i], vertexShaders[i]);
+        glAttachShader(programs[i], fragmentShaders[i]);
+        glLinkProgram(programs[i]);
+    }
+
+    // ... then wait for the results, which is where parallel compilation pays off
+    for (size_t i : pending)
+    {
+        bool compiled = checkShader(vertexShaders[i]) & checkShader(fragmentShaders[i]);
+        bool linked = checkProgram(programs[i]);
+
+        glDetachShader(programs[i], vertexShaders[i]);
+        glDetachShader(programs[i], fragmentShaders[i]);
+        glDeleteShader(vertexShaders[i]);
+        glDeleteShader(fragmentShaders[i]);
+
+        if (!compiled || !linked)
+        {
+            fprintf(stderr, "Failed to build program %s + %s\n", sources[i].vertexLabel.c_str(), sources[i].fragmentLabel.c_str());
+            glDeleteProgram(programs[i]);
+            programs[i] = 0;
+            continue;
+        }
+        if (useBinaries)
+            storeBinary(keys[i], programs[i]);
+    }
+    return programs;
+}
@@ -0,0 +1,68 @@
+#ifndef PROGRAMCACHE_HPP
+#define PROGRAMCACHE_HPP
+
+#include <GL/glew.h>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/**
+ * @brief GLSL sources for one vertex/fragment program.
+ *
+ * The labels are only used in log messages. Defines are part of the cache key
+ * and are expected to already be spliced into the code.
+ */
+struct ProgramSource
+{
+    std::string vertexLabel;
+    std::string fragmentLabel;
+    std::string vertexCode;
+    std::string fragmentCode;
+    std::string defines;
+};
+
+/**
+ * @brief Compiles and links shader programs, caching the linked binaries on disk.
+ *
+ * Programs are keyed by a hash of their sources, defines and the driver's
+ * vendor/renderer/version strings. A hit is reloaded with glProgramBinary; a
+ * miss, or a binary the driver rejects, is compiled from source and its binary
+ * stored for the next launch.
+ *
+ * buildAll() issues every compile and link before checking any status, which
+ * lets drivers with GL_KHR_parallel_shader_compile build the programs concurrently.
+ * Builds are serialized, so contexts sharing objects may use the cache from
+ * different threads.
+ */
+class ProgramCache
+{
+public:
+    static ProgramCache &instance();
+
+    void setDirectory(const std::string &directory);
+    const std::string &getDirectory() const { return directory; }
+
+    GLuint build(const ProgramSource &source);
+    std::vector<GLuint> buildAll(const std::vector<ProgramSource> &sources);
+
+    unsigned int hits = 0;
+    unsigned int misses = 0;
+
+private:
+    ProgramCache();
+
+    uint64_t key(const ProgramSource &source);
+    std::string binaryPath(uint64_t key) const;
+    bool binariesSupported();
+    GLuint loadBinary(uint64_t key);
+    void storeBinary(uint64_t key, GLuint program);
+
+    std::mutex mutex;
+    std::string directory;
+    std::string driver;
+    int binaryFormats;
+    bool parallelCompileEnabled;
+};
+
+#endif
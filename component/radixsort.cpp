@@ -0,0 +1,67 @@
+#include "radixsort.hpp"
+#include "threadpool.hpp"
+
+#include <algorithm>
+
+/**
+ * @brief Sorts keys ascending by their low keyBits bits, moving values with them.
+ *
+ * Digits are at most 11 bits, so the per-chunk histograms stay small; 20-bit
+ * keys take two passes and 30-bit keys three.
+ *
+ * @param keys Keys, each below 2^keyBits; sorted in place.
+ * @param values One value per key, permuted alongside.
+ */
+void RadixSort::sort(std::vector<uint32_t> &keys, std::vector<uint32_t> &values, unsigned int keyBits)
+{
+    size_t count = keys.size();
+    if (count == 0 || keyBits == 0)
+        return;
+    keyScratch.resize(count);
+    valueScratch.resize(count);
+
+    unsigned int passes = (keyBits + 10) / 11;
+    unsigned int digitBits = (keyBits + passes - 1) / passes;
+    size_t digits = (size_t)1 << digitBits;
+    uint32_t mask = (uint32_t)digits - 1;
+    size_t chunks = std::min<size_t>(64, (count + grain - 1) / grain);
+    size_t chunkSize = (count + chunks - 1) / chunks;
+    auto chunkEnd = [&](size_t chunk) { return std::min(count, (chunk + 1) * chunkSize); };
+    histograms.resize(chunks * digits);
+
+    ThreadPool &pool = ThreadPool::shared();
+    for (unsigned int shift = 0; shift < keyBits; shift += digitBits)
+    {
+        pool.parallelFor(0, chunks, 1, [&](size_t begin, size_t end) {
+            for (size_t chunk = begin; chunk < end; chunk++)
+            {
+                uint32_t *histogram = &histograms[chunk * digits];
+                std::fill(histogram, histogram + digits, 0u);
+                for (size_t i = chunk * chunkSize; i < chunkEnd(chunk); i++)
+                    histogram[(keys[i] >> shift) & mask]++;
+            }
+        });
+        uint32_t running = 0;
+        for (size_t digit = 0; digit < digits; digit++)
+            for (size_t chunk = 0; chunk < chunks; chunk++)
+            {
+                uint32_t keysWithDigit = histograms[chunk * digits + digit];
+                histograms[chunk * digits + digit] = running;
+                running += keysWithDigit;
+            }
+        pool.parallelFor(0, chunks, 1, [&](size_t begin, size_t end) {
+            for (size_t chunk = begin; chunk < end; chunk++)
+            {
+                uint32_t *cursor = &histograms[chunk * digits];
+                for (size_t i = chunk * chunkSize; i < chunkEnd(chunk); i++)
+                {
+                    uint32_t slot = cursor[(keys[i] >> shift) & mask]++;
+                    keyScratch[slot] = keys[i];
+                    valueScratch[slot] = values[i];
+                }
+            }
+        });
+        keys.swap(keyScratch);
+        values.swap(valueScratch);
+    }
+}
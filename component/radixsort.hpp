@@ -0,0 +1,29 @@
+#ifndef RADIXSORT_HPP
+#define RADIXSORT_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+ * @brief Parallel, stable LSD radix sort of 32-bit keys carrying a 32-bit value each.
+ *
+ * The keys are split into a fixed number of chunks, and each pass counts its
+ * digit per chunk on the thread pool and gives every chunk its own run of
+ * slots per digit, taken digit-major and chunk-minor. The scatter is therefore
+ * stable however the threads are scheduled: equal keys keep their values in
+ * input order. Scratch space and histograms are kept between sorts.
+ */
+class RadixSort
+{
+public:
+    void sort(std::vector<uint32_t> &keys, std::vector<uint32_t> &values, unsigned int keyBits);
+
+    static const size_t grain = 16384;
+
+private:
+    std::vector<uint32_t> keyScratch, valueScratch;
+    std::vector<uint32_t> histograms; // Per chunk and digit
+};
+
+#endif
@@ -13,99 +13,49 @@ using namespace std;
 #include <GL/glew.h>
 
 #include "shader.hpp"
+#include "profiler.hpp"
+#include "programcache.hpp"
+#include "shadervariants.hpp"
+#include "assetpack.hpp"
+
+bool readShaderFile(const char * file_path, std::string & code){
+	// From the asset pack when one is open, otherwise from the loose file
+	Asset asset;
+	if(!readAsset(file_path, asset)){
+		printf("Impossible to open %s. Are you in the right directory ? Don't forget to read the FAQ !\n", file_path);
+		return false;
+	}
+	code = asset.text();
+	return true;
+}
 
 GLuint LoadShaders(const char * vertex_file_path,const char * fragment_file_path){
+	PROFILE_SCOPE("LoadShaders");
 
-	// Create the shaders
-	GLuint VertexShaderID = glCreateShader(GL_VERTEX_SHADER);
-	GLuint FragmentShaderID = glCreateShader(GL_FRAGMENT_SHADER);
-
-	// Read the Vertex Shader code from the file
-	std::string VertexShaderCode;
-	std::ifstream VertexShaderStream(vertex_file_path, std::ios::in);
-	if(VertexShaderStream.is_open()){
-		std::stringstream sstr;
-		sstr << VertexShaderStream.rdbuf();
-		VertexShaderCode = sstr.str();
-		VertexShaderStream.close();
-	}else{
-		printf("Impossible to open %s. Are you in the right directory ? Don't forget to read the FAQ !\n", vertex_file_path);
-		getchar();
+	// Read the shaders, expanding #include directives
+	ProgramSource source;
+	std::vector<std::string> dependencies;
+	if(!preprocessShader(vertex_file_path, "", source.vertexCode, dependencies)){
 		return 0;
 	}
-
-	// Read the Fragment Shader code from the file
-	std::string FragmentShaderCode;
-	std::ifstream FragmentShaderStream(fragment_file_path, std::ios::in);
-	if(FragmentShaderStream.is_open()){
-		std::stringstream sstr;
-		sstr << FragmentShaderStream.rdbuf();
-		FragmentShaderCode = sstr.str();
-		FragmentShaderStream.close();
-	}
-
-	GLint Result = GL_FALSE;
-	int InfoLogLength;
-
-
-	// Compile Vertex Shader
-	printf("Compiling shader : %s\n", vertex_file_path);
-	char const * VertexSourcePointer = VertexShaderCode.c_str();
-	glShaderSource(VertexShaderID, 1, &VertexSourcePointer , NULL);
-	glCompileShader(VertexShaderID);
-
-	// Check Vertex Shader
-	glGetShaderiv(VertexShaderID, GL_COMPILE_STATUS, &Result);
-	glGetShaderiv(VertexShaderID, GL_INFO_LOG_LENGTH, &InfoLogLength);
-	if ( InfoLogLength > 0 ){
-		std::vector<char> VertexShaderErrorMessage(InfoLogLength+1);
-		glGetShaderInfoLog(VertexShaderID, InfoLogLength, NULL, &VertexShaderErrorMessage[0]);
-		printf("%s\n", &VertexShaderErrorMessage[0]);
-	}
-
-
-
-	// Compile Fragment Shader
-	printf("Compiling shader : %s\n", fragment_file_path);
-	char const * FragmentSourcePointer = FragmentShaderCode.c_str();
-	glShaderSource(FragmentShaderID, 1, &FragmentSourcePointer , NULL);
-	glCompileShader(FragmentShaderID);
-
-	// Check Fragment Shader
-	glGetShaderiv(FragmentShaderID, GL_COMPILE_STATUS, &Result);
-	glGetShaderiv(FragmentShaderID, GL_INFO_LOG_LENGTH, &InfoLogLength);
-	if ( InfoLogLength > 0 ){
-		std::vector<char> FragmentShaderErrorMessage(InfoLogLength+1);
-		glGetShaderInfoLog(FragmentShaderID, InfoLogLength, NULL, &FragmentShaderErrorMessage[0]);
-		printf("%s\n", &FragmentShaderErrorMessage[0]);
-	}
-
-
-
-	// Link the program
-	printf("Linking program\n");
-	GLuint ProgramID = glCreateProgram();
-	glAttachShader(ProgramID, VertexShaderID);
-	glAttachShader(ProgramID, FragmentShaderID);
-	glLinkProgram(ProgramID);
-
-	// Check the program
-	glGetProgramiv(ProgramID, GL_LINK_STATUS, &Result);
-	glGetProgramiv(ProgramID, GL_INFO_LOG_LENGTH, &InfoLogLength);
-	if ( InfoLogLength > 0 ){
-		std::vector<char> ProgramErrorMessage(InfoLogLength+1);
-		glGetProgramInfoLog(ProgramID, InfoLogLength, NULL, &ProgramErrorMessage[0]);
-		printf("%s\n", &ProgramErrorMessage[0]);
+	if(!preprocessShader(fragment_file_path, "", source.fragmentCode, dependencies)){
+		return 0;
 	}
 
-	
-	glDetachShader(ProgramID, VertexShaderID);
-	glDetachShader(ProgramID, FragmentShaderID);
-	
-	glDeleteShader(VertexShaderID);
-	glDeleteShader(FragmentShaderID);
-
-	return ProgramID;
+	// Compile and link, or reuse the binary cached by a previous run
+	source.vertexLabel = vertex_file_path;
+	source.fragmentLabel = fragment_file_path;
+	return ProgramCache::instance().build(source);
 }
 
+// Builds a program from GLSL already in memory. #include is not expanded here.
+GLuint LoadShaders(const std::string & vertex_code, const std::string & fragment_code, const char * label){
+	PROFILE_SCOPE("LoadShaders");
 
+	ProgramSource source;
+	source.vertexLabel = std::string(label) + " (vertex)";
+	source.fragmentLabel = std::string(label) + " (fragment)";
+	source.vertexCode = vertex_code;
+	source.fragmentCode = fragment_code;
+	return ProgramCache::instance().build(source);
+}
@@ -1,6 +1,11 @@
 #ifndef SHADER_HPP
 #define SHADER_HPP
 
+#include <GL/glew.h>
+#include <string>
+
+bool readShaderFile(const char * file_path, std::string & code);
 GLuint LoadShaders(const char * vertex_file_path,const char * fragment_file_path);
+GLuint LoadShaders(const std::string & vertex_code, const std::string & fragment_code, const char * label);
 
 #endif
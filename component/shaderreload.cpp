@@ -0,0 +1,224 @@
+#include "shaderreload.hpp"
+#include "programcache.hpp"
+#include "profiler.hpp"
+
+#include <stdio.h>
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+
+#ifdef __linux__
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+    const int watchIntervalMs = 100;
+}
+
+/**
+ * @brief Starts watching a shader directory. Must be called on the main thread.
+ *
+ * @param window Main window; its context shares objects with the rebuild context.
+ * @param directory Directory holding the shader sources, e.g. "../shader".
+ */
+ShaderHotReload::ShaderHotReload(GLFWwindow *window, const std::string &directory)
+    : context(nullptr), directory(directory), stopping(false), inotifyFd(-1)
+{
+    // Window hints still hold the main window's context version and profile
+    glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+    context = glfwCreateWindow(1, 1, "shader reload", NULL, window);
+    glfwWindowHint(GLFW_VISIBLE, GLFW_TRUE);
+    if (!context)
+    {
+        fprintf(stderr, "Shader hot reload disabled: failed to create a shared context\n");
+        return;
+    }
+
+#ifdef __linux__
+    inotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (inotifyFd < 0 || inotify_add_watch(inotifyFd, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE) < 0)
+    {
+        fprintf(stderr, "inotify unavailable for %s, polling modification times\n", directory.c_str());
+        if (inotifyFd >= 0)
+            close(inotifyFd);
+        inotifyFd = -1;
+    }
+#endif
+    if (inotifyFd < 0)
+    {
+        std::vector<std::string> ignored;
+        watch(ignored);
+    }
+
+    worker = std::thread(&ShaderHotReload::run, this);
+    printf("Watching %s for shader changes\n", directory.c_str());
+}
+
+ShaderHotReload::~ShaderHotReload()
+{
+    stopping = true;
+    if (worker.joinable())
+        worker.join();
+#ifdef __linux__
+    if (inotifyFd >= 0)
+        close(inotifyFd);
+#endif
+    if (context)
+        glfwDestroyWindow(context);
+
+    // Programs built after the last poll() were never installed
+    for (const Result &result : results)
+    {
+        if (result.program)
+            glDeleteProgram(result.program);
+    }
+}
+
+/**
+ * @brief Collects changed files in the shader directory, waiting up to watchIntervalMs.
+ */
+void ShaderHotReload::watch(std::vector<std::string> &changed)
+{
+#ifdef __linux__
+    if (inotifyFd >= 0)
+    {
+        pollfd descriptor = {inotifyFd, POLLIN, 0};
+        if (::poll(&descriptor, 1, watchIntervalMs) <= 0)
+            return;
+
+        alignas(inotify_event) char buffer[4096];
+        ssize_t length;
+        while ((length = read(inotifyFd, buffer, sizeof(buffer))) > 0)
+        {
+            for (char *cursor = buffer; cursor < buffer + length;)
+            {
+                const inotify_event *event = (const inotify_event *)cursor;
+                if (event->len > 0)
+                    changed.push_back(directory + "/" + event->name);
+                cursor += sizeof(inotify_event) + event->len;
+            }
+        }
+        return;
+    }
+#endif
+    std::error_code error;
+    for (const auto &entry : std::filesystem::directory_iterator(directory, error))
+    {
+        std::string path = entry.path().string();
+        long long time = entry.last_write_time(error).time_since_epoch().count();
+        auto known = modificationTimes.find(path);
+        if (known != modificationTimes.end() && known->second != time)
+            changed.push_back(path);
+        modificationTimes[path] = time;
+    }
+    if (changed.empty())
+        std::this_thread::sleep_for(std::chrono::milliseconds(watchIntervalMs));
+}
+
+/**
+ * @brief Compiles one variant from the current sources on the shared context.
+ */
+ShaderHotReload::Result ShaderHotReload::build(const Job &job)
+{
+    PROFILE_SCOPE("shader rebuild");
+
+    Result result = {job.variant, 0, {}};
+    ProgramSource source;
+    source.vertexLabel = job.vertexPath;
+    source.fragmentLabel = job.fragmentPath;
+    source.defines = shaderDefines(job.features);
+    std::vector<std::string> fragmentDependencies;
+    if (!preprocessShader(job.vertexPath, source.defines, source.vertexCode, result.dependencies) ||
+        !preprocessShader(job.fragmentPath, source.defines, source.fragmentCode, fragmentDependencies))
+    {
+        return result;
+    }
+    result.dependencies.insert(result.dependencies.end(), fragmentDependencies.begin(), fragmentDependencies.end());
+    result.program = ProgramCache::instance().build(source);
+    return result;
+}
+
+void ShaderHotReload::run()
+{
+    PROFILE_THREAD_NAME("shader reload");
+    glfwMakeContextCurrent(context);
+
+    while (!stopping)
+    {
+        std::vector<std::string> changed;
+        watch(changed);
+        std::vector<Job> pending;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            changedFiles.insert(changedFiles.end(), changed.begin(), changed.end());
+            // Editors save in several events; wait for a quiet interval so they make one rebuild
+            if (changed.empty())
+                pending.swap(jobs);
+        }
+        if (pending.empty())
+            continue;
+
+        std::vector<Result> built;
+        for (const Job &job : pending)
+        {
+            built.push_back(build(job));
+        }
+        // Make sure the programs are complete before the main context uses them
+        glFinish();
+
+        std::lock_guard<std::mutex> lock(mutex);
+        results.insert(results.end(), built.begin(), built.end());
+    }
+
+    glfwMakeContextCurrent(NULL);
+}
+
+/**
+ * @brief Queues rebuilds for changed files and installs finished programs.
+ *
+ * Call once per frame on the main thread, outside of rendering.
+ *
+ * @return true if any variant's program changed; owners should re-read ShaderVariant::program.
+ */
+bool ShaderHotReload::poll()
+{
+    if (!context)
+        return false;
+
+    std::vector<Result> ready;
+    std::vector<std::string> changed;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        ready.swap(results);
+        changed.swap(changedFiles);
+    }
+
+    if (!changed.empty())
+    {
+        std::vector<const ShaderVariant *> affected = ShaderVariants::instance().dependents(changed);
+        std::lock_guard<std::mutex> lock(mutex);
+        for (const ShaderVariant *variant : affected)
+        {
+            // A rebuild still waiting reads the sources when it runs, so it covers this change too
+            if (std::none_of(jobs.begin(), jobs.end(), [variant](const Job &job) { return job.variant == variant; }))
+                jobs.push_back(Job{variant, variant->vertexPath, variant->fragmentPath, variant->features});
+        }
+    }
+
+    bool swapped = false;
+    for (const Result &result : ready)
+    {
+        if (result.program == 0)
+        {
+            fprintf(stderr, "Shader reload failed for %s + %s, keeping the previous program\n",
+                    result.variant->vertexPath.c_str(), result.variant->fragmentPath.c_str());
+            continue;
+        }
+        ShaderVariants::instance().replace(result.variant, result.program, result.dependencies);
+        swapped = true;
+    }
+    return swapped;
+}
@@ -0,0 +1,67 @@
+#ifndef SHADERRELOAD_HPP
+#define SHADERRELOAD_HPP
+
+#include <GL/glew.h>
+#include <GLFW/glfw3.h>
+#include <atomic>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "shadervariants.hpp"
+
+/**
+ * @brief Rebuilds shader variants when their source files change on disk.
+ *
+ * A background thread watches the shader directory (inotify on Linux, modification
+ * times elsewhere) and recompiles affected variants on a hidden context that shares
+ * objects with the main window. poll() installs finished programs at a frame
+ * boundary; a variant whose new source fails to build keeps its old program.
+ */
+class ShaderHotReload
+{
+public:
+    ShaderHotReload(GLFWwindow *window, const std::string &directory);
+    ~ShaderHotReload();
+
+    ShaderHotReload(const ShaderHotReload &) = delete;
+    ShaderHotReload &operator=(const ShaderHotReload &) = delete;
+
+    bool poll();
+
+private:
+    struct Job
+    {
+        const ShaderVariant *variant;
+        std::string vertexPath;
+        std::string fragmentPath;
+        unsigned int features;
+    };
+
+    struct Result
+    {
+        const ShaderVariant *variant;
+        GLuint program;
+        std::vector<std::string> dependencies;
+    };
+
+    void run();
+    void watch(std::vector<std::string> &changed);
+    Result build(const Job &job);
+
+    GLFWwindow *context;
+    std::string directory;
+    std::thread worker;
+    std::atomic<bool> stopping;
+
+    std::mutex mutex;
+    std::vector<std::string> changedFiles;
+    std::vector<Job> jobs;
+    std::vector<Result> results;
+
+    int inotifyFd;
+    std::map<std::string, long long> modificationTimes;
+};
+
+#endif
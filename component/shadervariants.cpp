@@ -0,0 +1,291 @@
+#include "shadervariants.hpp"
+#include "shader.hpp"
+#include "programcache.hpp"
+#include "profiler.hpp"
+
+#include <stdio.h>
+#include <algorithm>
+#include <filesystem>
+#include <sstream>
+
+namespace
+{
+    struct FeatureName
+    {
+        unsigned int bit;
+        const char *define;
+    };
+
+    const FeatureName featureNames[] = {
+        {SHADER_TEXTURED, "TEXTURED"},
+        {SHADER_SOFT, "SOFT"},
+        {SHADER_ATLAS, "ATLAS"},
+        {SHADER_LIFE_CURVES, "LIFE_CURVES"},
+    };
+
+    std::string normalized(const std::string &path)
+    {
+        return std::filesystem::path(path).lexically_normal().string();
+    }
+
+    std::string directoryOf(const std::string &path)
+    {
+        size_t slash = path.find_last_of("/\\");
+        return slash == std::string::npos ? std::string() : path.substr(0, slash + 1);
+    }
+
+    /**
+     * @brief Expands #include directives and injects defines after #version.
+     *
+     * Each file is included at most once per shader. #line directives keep
+     * compiler messages pointing at the original file (by dependency index) and line.
+     */
+    class Preprocessor
+    {
+    public:
+        Preprocessor(const std::string &defines, std::string &code, std::vector<std::string> &dependencies)
+            : defines(defines), code(code), dependencies(dependencies), versionSeen(false)
+        {
+        }
+
+        bool expand(const std::string &path, bool root)
+        {
+            if (std::find(stack.begin(), stack.end(), path) != stack.end())
+            {
+                fprintf(stderr, "Recursive #include of %s\n", path.c_str());
+                return false;
+            }
+            if (!root && std::find(dependencies.begin(), dependencies.end(), path) != dependencies.end())
+                return true;
+
+            std::string source;
+            if (!readShaderFile(path.c_str(), source))
+                return false;
+            dependencies.push_back(path);
+            size_t fileIndex = dependencies.size() - 1;
+            stack.push_back(path);
+            if (!root)
+                code += lineDirective(1, fileIndex);
+
+            std::istringstream lines(source);
+            std::string line;
+            int lineNumber = 0;
+            while (std::getline(lines, line))
+            {
+                lineNumber++;
+                if (!line.empty() && line.back() == '\r')
+                    line.pop_back();
+                size_t start = line.find_first_not_of(" \t");
+                std::string directive = start == std::string::npos ? std::string() : line.substr(start);
+
+                if (directive.compare(0, 8, "#version") == 0)
+                {
+                    // Only the top-level file decides the version
+                    if (root && !versionSeen)
+                    {
+                        code += line + "\n" + defines;
+                        versionSeen = true;
+                    }
+                    code += lineDirective(lineNumber + 1, fileIndex);
+                    continue;
+                }
+                if (directive.compare(0, 8, "#include") == 0)
+                {
+                    size_t open = directive.find('"');
+                    size_t close = directive.find('"', open + 1);
+                    if (open == std::string::npos || close == std::string::npos)
+                    {
+                        fprintf(stderr, "%s:%d: malformed #include\n", path.c_str(), lineNumber);
+                        return false;
+                    }
+                    std::string included = directoryOf(path) + directive.substr(open + 1, close - open - 1);
+                    if (!expand(included, false))
+                    {
+                        fprintf(stderr, "  included from %s:%d\n", path.c_str(), lineNumber);
+                        return false;
+                    }
+                    code += lineDirective(lineNumber + 1, fileIndex);
+                    continue;
+                }
+                code += line + "\n";
+            }
+
+            stack.pop_back();
+            if (root && !versionSeen)
+                code = defines + code;
+            return true;
+        }
+
+    private:
+        static std::string lineDirective(int line, size_t fileIndex)
+        {
+            return "#line " + std::to_string(line) + " " + std::to_string(fileIndex) + "\n";
+        }
+
+        const std::string &defines;
+        std::string &code;
+        std::vector<std::string> &dependencies;
+        std::vector<std::string> stack;
+        bool versionSeen;
+    };
+}
+
+/**
+ * @brief Reads a shader, resolving #include "file" relative to the including file
+ * and inserting the given defines right after the #version line.
+ *
+ * @param path Top-level shader file.
+ * @param defines Lines to inject, e.g. from shaderDefines().
+ * @param code Receives the expanded source.
+ * @param dependencies Receives every file read, the top-level file first.
+ * @return false if a file could not be read or an include is malformed or recursive.
+ */
+bool preprocessShader(const std::string &path, const std::string &defines, std::string &code, std::vector<std::string> &dependencies)
+{
+    code.clear();
+    dependencies.clear();
+    Preprocessor preprocessor(defines, code, dependencies);
+    return preprocessor.expand(path, true);
+}
+
+/**
+ * @brief Returns the #define lines for a ShaderFeature bitmask.
+ */
+std::string shaderDefines(unsigned int features)
+{
+    std::string defines;
+    for (const FeatureName &feature : featureNames)
+    {
+        if (features & feature.bit)
+            defines += std::string("#define ") + feature.define + "\n";
+    }
+    return defines;
+}
+
+/**
+ * @brief Returns the process-wide variant cache. Must only be used on the GL thread.
+ */
+ShaderVariants &ShaderVariants::instance()
+{
+    static ShaderVariants cache;
+    return cache;
+}
+
+std::string ShaderVariants::key(const std::string &vertexPath, const std::string &fragmentPath, unsigned int features)
+{
+    return vertexPath + "\n" + fragmentPath + "\n" + std::to_string(features);
+}
+
+/**
+ * @brief Returns the program for a feature set, building it on first use.
+ *
+ * A variant that fails to build is cached with program 0 rather than retried every call.
+ *
+ * @param vertexPath Vertex shader file.
+ * @param fragmentPath Fragment shader file.
+ * @param features Bitwise OR of ShaderFeature values.
+ */
+const ShaderVariant *ShaderVariants::get(const std::string &vertexPath, const std::string &fragmentPath, unsigned int features)
+{
+    std::unique_ptr<ShaderVariant> &variant = variants[key(vertexPath, fragmentPath, features)];
+    if (variant)
+        return variant.get();
+
+    prewarm(vertexPath, fragmentPath, std::vector<unsigned int>(1, features));
+    return variant.get();
+}
+
+/**
+ * @brief Builds every missing variant of a shader pair in one batch.
+ *
+ * Batching lets ProgramCache overlap the compiles on drivers with parallel shader compilation.
+ */
+void ShaderVariants::prewarm(const std::string &vertexPath, const std::string &fragmentPath, const std::vector<unsigned int> &featureSets)
+{
+    PROFILE_SCOPE("ShaderVariants::prewarm");
+
+    std::vector<ProgramSource> sources;
+    std::vector<ShaderVariant *> building;
+    for (unsigned int features : featureSets)
+    {
+        std::unique_ptr<ShaderVariant> &variant = variants[key(vertexPath, fragmentPath, features)];
+        if (variant && variant->program != 0)
+            continue;
+
+        // Reuse a failed entry in place; callers may still hold a pointer to it
+        if (!variant)
+            variant.reset(new ShaderVariant());
+        variant->vertexPath = vertexPath;
+        variant->fragmentPath = fragmentPath;
+        variant->features = features;
+        variant->program = 0;
+
+        ProgramSource source;
+        source.vertexLabel = vertexPath;
+        source.fragmentLabel = fragmentPath;
+        source.defines = shaderDefines(features);
+        std::vector<std::string> fragmentDependencies;
+        if (!preprocessShader(vertexPath, source.defines, source.vertexCode, variant->dependencies) ||
+            !preprocessShader(fragmentPath, source.defines, source.fragmentCode, fragmentDependencies))
+        {
+            continue;
+        }
+        variant->dependencies.insert(variant->dependencies.end(), fragmentDependencies.begin(), fragmentDependencies.end());
+        sources.push_back(source);
+        building.push_back(variant.get());
+    }
+
+    std::vector<GLuint> programs = ProgramCache::instance().buildAll(sources);
+    for (size_t i = 0; i < building.size(); i++)
+    {
+        building[i]->program = programs[i];
+    }
+}
+
+/**
+ * @brief Returns every variant built from any of the given files, includes counted.
+ */
+std::vector<const ShaderVariant *> ShaderVariants::dependents(const std::vector<std::string> &files) const
+{
+    std::vector<std::string> changed;
+    for (const std::string &file : files)
+    {
+        changed.push_back(normalized(file));
+    }
+
+    std::vector<const ShaderVariant *> result;
+    for (const auto &entry : variants)
+    {
+        const ShaderVariant *variant = entry.second.get();
+        for (const std::string &dependency : variant->dependencies)
+        {
+            if (std::find(changed.begin(), changed.end(), normalized(dependency)) != changed.end())
+            {
+                result.push_back(variant);
+                break;
+            }
+        }
+    }
+    return result;
+}
+
+/**
+ * @brief Installs a rebuilt program for a variant and deletes the one it replaces.
+ *
+ * @param variant Variant returned by get().
+ * @param program Newly linked program; the cache takes ownership.
+ * @param dependencies Files the new program was built from.
+ */
+void ShaderVariants::replace(const ShaderVariant *variant, GLuint program, const std::vector<std::string> &dependencies)
+{
+    std::unique_ptr<ShaderVariant> &entry = variants[key(variant->vertexPath, variant->fragmentPath, variant->features)];
+    if (entry.get() != variant)
+    {
+        glDeleteProgram(program);
+        return;
+    }
+    if (entry->program != 0)
+        glDeleteProgram(entry->program);
+    entry->program = program;
+    entry->dependencies = dependencies;
+}
@@ -0,0 +1,61 @@
+#ifndef SHADERVARIANTS_HPP
+#define SHADERVARIANTS_HPP
+
+#include <GL/glew.h>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Optional shader features. Each bit is exposed to GLSL as a #define of the same name
+ * without the SHADER_ prefix, e.g. SHADER_TEXTURED -> #define TEXTURED.
+ */
+enum ShaderFeature : unsigned int
+{
+    SHADER_TEXTURED = 1u << 0, // Modulate by the sprite texture
+    SHADER_SOFT = 1u << 1,     // Fade the sprite out towards its edge
+    SHADER_ATLAS = 1u << 2,    // Sample a layer of a sprite atlas (sampler2DArray)
+    SHADER_LIFE_CURVES = 1u << 3, // Scale color, alpha and size by curves over the particle's age
+};
+
+/**
+ * @brief One compiled permutation of a vertex/fragment shader pair.
+ */
+struct ShaderVariant
+{
+    std::string vertexPath;
+    std::string fragmentPath;
+    unsigned int features;
+    GLuint program;
+    std::vector<std::string> dependencies; // Every file read to build it, includes too
+};
+
+bool preprocessShader(const std::string &path, const std::string &defines, std::string &code, std::vector<std::string> &dependencies);
+std::string shaderDefines(unsigned int features);
+
+/**
+ * @brief Builds shader permutations on demand and keeps them for the lifetime of the process.
+ *
+ * Sources go through preprocessShader(), so they may #include other files and
+ * #ifdef on feature defines instead of branching at runtime. Returned pointers
+ * stay valid until the cache is destroyed.
+ */
+class ShaderVariants
+{
+public:
+    static ShaderVariants &instance();
+
+    const ShaderVariant *get(const std::string &vertexPath, const std::string &fragmentPath, unsigned int features);
+    void prewarm(const std::string &vertexPath, const std::string &fragmentPath, const std::vector<unsigned int> &featureSets);
+
+    std::vector<const ShaderVariant *> dependents(const std::vector<std::string> &files) const;
+    void replace(const ShaderVariant *variant, GLuint program, const std::vector<std::string> &dependencies);
+
+private:
+    static std::string key(const std::string &vertexPath, const std::string &fragmentPath, unsigned int features);
+
+    std::map<std::string, std::unique_ptr<ShaderVariant>> variants;
+};
+
+#endif
@@ -0,0 +1,68 @@
+#include "spatialgrid.hpp"
+#include "profiler.hpp"
+
+#include <algorithm>
+
+/**
+ * @brief Rebuilds the grid over a new set of positions.
+ *
+ * Every point's bucket hash is computed in parallel, then the point indices
+ * are sorted by bucket with RadixSort. The sort is stable, so each bucket lists
+ * its points in index order however the threads are scheduled. The bucket
+ * starts are then read off the sorted hashes. The
+ * table has at least one bucket per point and keeps its storage between
+ * builds.
+ *
+ * @param positions First position; the next one is stride bytes further on, so
+ * positions can be read straight out of an array of structs.
+ * @param cellSize Edge of a grid cell; at least the largest query radius.
+ */
+void SpatialGrid::build(const glm::vec3 *positions, size_t count, size_t stride, float cellSize)
+{
+    PROFILE_SCOPE("build spatial grid");
+    this->count = count;
+    cell = cellSize;
+    inverseCell = 1.0f / cellSize;
+    ordered = false;
+    tableSize = 1024;
+    unsigned int tableBits = 10;
+    while (tableSize < count)
+    {
+        tableSize *= 2;
+        tableBits++;
+    }
+    buckets.resize(count);
+    order.resize(count);
+    starts.resize(tableSize + 1);
+    if (count == 0)
+    {
+        std::fill(starts.begin(), starts.end(), 0u);
+        return;
+    }
+
+    ThreadPool &pool = ThreadPool::shared();
+    const unsigned char *base = (const unsigned char *)positions;
+    pool.parallelFor(0, count, grain, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++)
+        {
+            const glm::vec3 &p = *(const glm::vec3 *)(base + i * stride);
+            buckets[i] = hash(cellCoordinate(p.x), cellCoordinate(p.y), cellCoordinate(p.z));
+            order[i] = (uint32_t)i;
+        }
+    });
+
+    sorter.sort(buckets, order, tableBits);
+
+    // A bucket starts at the first sorted point with its hash; empty buckets start where the next one does
+    pool.parallelFor(0, count, grain, [&](size_t begin, size_t end) {
+        for (size_t k = begin; k < end; k++)
+        {
+            if (k > 0 && buckets[k] == buckets[k - 1])
+                continue;
+            for (uint32_t b = k == 0 ? 0 : buckets[k - 1] + 1; b <= buckets[k]; b++)
+                starts[b] = (uint32_t)k;
+        }
+    });
+    for (size_t b = buckets[count - 1] + 1; b <= tableSize; b++)
+        starts[b] = (uint32_t)count;
+}
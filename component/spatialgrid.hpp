@@ -0,0 +1,183 @@
+#ifndef SPATIALGRID_HPP
+#define SPATIALGRID_HPP
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include <glm/glm.hpp>
+#include "radixsort.hpp"
+#include "threadpool.hpp"
+
+/**
+ * @brief Uniform hashed cell list for fixed-radius neighbour queries, rebuilt every step.
+ *
+ * Points are bucketed by the hash of their cell and radix-sorted into one
+ * index array in bucket order, in parallel on the thread pool (see RadixSort). A query visits
+ * the buckets of the 27 cells around a point, so with the cell size at least
+ * the query radius it sees every neighbour. Distinct cells can share a bucket,
+ * so queries still check distances. After build(), reorder() can move the
+ * items themselves into bucket order, which keeps the neighbours of each item
+ * close together in memory.
+ */
+class SpatialGrid
+{
+public:
+    void build(const glm::vec3 *positions, size_t count, size_t stride, float cellSize);
+
+    /**
+     * @brief Gathers items into bucket order, through scratch, and makes the grid index them directly.
+     *
+     * Call it once per build(), for the items the positions were read from.
+     */
+    template <typename Item>
+    void reorder(std::vector<Item> &items, std::vector<Item> &scratch)
+    {
+        scratch.resize(items.size());
+        ThreadPool::shared().parallelFor(0, items.size(), grain, [&](size_t begin, size_t end) {
+            for (size_t k = begin; k < end; k++)
+                scratch[k] = items[order[k]];
+        });
+        items.swap(scratch);
+        ordered = true;
+    }
+
+    /**
+     * @brief Calls visit(index) for every item in the buckets around position, including the item itself.
+     */
+    template <typename Visit>
+    void forEachCandidate(const glm::vec3 &position, Visit &&visit) const
+    {
+        if (count == 0)
+            return;
+        int x = cellCoordinate(position.x), y = cellCoordinate(position.y), z = cellCoordinate(position.z);
+        BucketSet seen;
+        for (int dz = -1; dz <= 1; dz++)
+            for (int dy = -1; dy <= 1; dy++)
+                for (int dx = -1; dx <= 1; dx++)
+                {
+                    uint32_t bucket = hash(x + dx, y + dy, z + dz);
+                    if (!seen.insert(bucket))
+                        continue;
+                    for (uint32_t slot = starts[bucket]; slot < starts[bucket + 1]; slot++)
+                        visit(ordered ? slot : order[slot]);
+                }
+    }
+
+    /**
+     * @brief Like forEachCandidate(), but skips the cells at least reach2() away from position.
+     *
+     * reach2 returns a squared distance and is called again before every cell,
+     * so a k-nearest query can shrink it as it fills up. The home cell comes
+     * first, then the cells sharing a face, an edge and a corner with it, so
+     * the reach usually shrinks before the far cells are tested.
+     */
+    template <typename Reach, typename Visit>
+    void forEachCandidateWithin(const glm::vec3 &position, Reach &&reach2, Visit &&visit) const
+    {
+        if (count == 0)
+            return;
+        static const signed char offsets[27][3] = {
+            {0, 0, 0},
+            {-1, 0, 0}, {1, 0, 0}, {0, -1, 0}, {0, 1, 0}, {0, 0, -1}, {0, 0, 1},
+            {-1, -1, 0}, {1, -1, 0}, {-1, 1, 0}, {1, 1, 0}, {-1, 0, -1}, {1, 0, -1},
+            {-1, 0, 1}, {1, 0, 1}, {0, -1, -1}, {0, 1, -1}, {0, -1, 1}, {0, 1, 1},
+            {-1, -1, -1}, {1, -1, -1}, {-1, 1, -1}, {1, 1, -1}, {-1, -1, 1}, {1, -1, 1}, {-1, 1, 1}, {1, 1, 1},
+        };
+        int home[3] = {cellCoordinate(position.x), cellCoordinate(position.y), cellCoordinate(position.z)};
+        float gaps[3][3]; // Squared distance from position to the cell before, at and after it, per axis
+        for (int axis = 0; axis < 3; axis++)
+        {
+            float low = position[axis] - (float)home[axis] * cell;
+            gaps[axis][0] = low * low;
+            gaps[axis][1] = 0.0f;
+            gaps[axis][2] = (cell - low) * (cell - low);
+        }
+        BucketSet seen;
+        for (const signed char *offset : offsets)
+        {
+            float distance2 = gaps[0][offset[0] + 1] + gaps[1][offset[1] + 1] + gaps[2][offset[2] + 1];
+            if (distance2 >= reach2())
+                continue;
+            uint32_t bucket = hash(home[0] + offset[0], home[1] + offset[1], home[2] + offset[2]);
+            if (!seen.insert(bucket))
+                continue;
+            for (uint32_t slot = starts[bucket]; slot < starts[bucket + 1]; slot++)
+                visit(ordered ? slot : order[slot]);
+        }
+    }
+
+    /**
+     * @brief Calls visit(index, offset, distance2) for every other item within radius of items[self].
+     *
+     * offset points from items[self] to the neighbour. Item is anything with a position member.
+     */
+    template <typename Item, typename Visit>
+    void forEachNeighbor(const Item *items, size_t self, float radius, Visit &&visit) const
+    {
+        const glm::vec3 &position = items[self].position;
+        float radius2 = radius * radius;
+        forEachCandidate(position, [&](size_t index) {
+            if (index == self)
+                return;
+            glm::vec3 offset = items[index].position - position;
+            float distance2 = glm::dot(offset, offset);
+            if (distance2 < radius2)
+                visit(index, offset, distance2);
+        });
+    }
+
+    size_t size() const { return count; }
+    size_t bucketCount() const { return tableSize; }
+    float cellSize() const { return cell; }
+
+    static const size_t grain = 16384;
+
+private:
+    /**
+     * @brief The buckets one query has visited, since distinct cells can share one.
+     */
+    struct BucketSet
+    {
+        uint32_t buckets[27];
+        int size = 0;
+        uint64_t filter[2] = {0, 0}; // Bloom filter over buckets, so most inserts skip the scan
+
+        bool insert(uint32_t bucket)
+        {
+            uint32_t bit = (bucket * 2654435761u) >> 25;
+            uint64_t mask = 1ull << (bit & 63);
+            if (filter[bit >> 6] & mask)
+                for (int i = 0; i < size; i++)
+                    if (buckets[i] == bucket)
+                        return false;
+            filter[bit >> 6] |= mask;
+            buckets[size++] = bucket;
+            return true;
+        }
+    };
+
+    int cellCoordinate(float value) const
+    {
+        float scaled = value * inverseCell;
+        int truncated = (int)scaled;
+        return truncated - (scaled < (float)truncated);
+    }
+    uint32_t hash(int x, int y, int z) const
+    {
+        return (((uint32_t)x * 73856093u) ^ ((uint32_t)y * 19349663u) ^ ((uint32_t)z * 83492791u)) & (uint32_t)(tableSize - 1);
+    }
+
+    size_t count = 0;
+    size_t tableSize = 0; // A power of two
+    float cell = 1.0f;
+    float inverseCell = 1.0f;
+    bool ordered = false; // Items were reordered, so slot k holds item k
+    std::vector<uint32_t> buckets;    // Bucket of each slot, sorted
+    std::vector<uint32_t> order;      // Item indices in bucket order
+    std::vector<uint32_t> starts;     // First slot of each bucket, plus the total
+    RadixSort sorter;
+};
+
+#endif
@@ -0,0 +1,95 @@
+#include "sph.hpp"
+#include "particlesys.hpp"
+#include "profiler.hpp"
+
+namespace
+{
+    const float pi = 3.14159265358979f;
+    const size_t sphGrain = 2048;
+}
+
+/**
+ * @brief Adds one substep of pressure and viscosity acceleration to every particle's velocity.
+ *
+ * @param grid Built over particles with a cell of at least params.smoothingRadius.
+ */
+void SphSolver::step(std::vector<Particle> &particles, const SpatialGrid &grid, const SphParams &params, float dt)
+{
+    PROFILE_SCOPE("sph step");
+    size_t count = particles.size();
+    density.resize(count);
+    pressure.resize(count);
+    acceleration.resize(count);
+    const Particle *items = particles.data();
+
+    float h = params.smoothingRadius, h2 = h * h;
+    float mass = params.particleMass();
+    float poly6 = 315.0f / (64.0f * pi * std::pow(h, 9.0f));
+    float spiky = 45.0f / (pi * std::pow(h, 6.0f)); // Gradient and viscosity Laplacian share this factor
+    auto overGround = [&](const glm::vec3 &position) {
+        return std::fabs(position.x) <= params.groundExtent && std::fabs(position.y) <= params.groundExtent;
+    };
+
+    ThreadPool &pool = ThreadPool::shared();
+    pool.parallelFor(0, count, sphGrain, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++)
+        {
+            float sum = h2 * h2 * h2;
+            grid.forEachNeighbor(items, i, h, [&](size_t, const glm::vec3 &, float distance2) {
+                float w = h2 - distance2;
+                sum += w * w * w;
+            });
+            // The ghost mirrored below the ground, at twice the height
+            const glm::vec3 &position = items[i].position;
+            float height = std::max(position.z - params.groundHeight, 0.0f);
+            if (2.0f * height < h && overGround(position))
+            {
+                float w = h2 - 4.0f * height * height;
+                sum += w * w * w;
+            }
+            density[i] = mass * poly6 * sum;
+            pressure[i] = params.stiffness * std::max(density[i] - params.restDensity, 0.0f);
+        }
+    });
+
+    pool.parallelFor(0, count, sphGrain, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++)
+        {
+            const Particle &p = items[i];
+            glm::vec3 pressureForce(0.0f), viscosityForce(0.0f);
+            grid.forEachNeighbor(items, i, h, [&](size_t j, const glm::vec3 &offset, float distance2) {
+                float r = std::sqrt(distance2);
+                if (r <= 0.0f)
+                    return;
+                float falloff = h - r;
+                pressureForce -= offset * ((pressure[i] + pressure[j]) / (2.0f * density[j]) * falloff * falloff / r);
+                viscosityForce += (items[j].velocity - p.velocity) * (falloff / density[j]);
+            });
+            float height = std::max(p.position.z - params.groundHeight, 1e-4f * h);
+            if (2.0f * height < h && overGround(p.position))
+            {
+                float falloff = h - 2.0f * height;
+                pressureForce.z += pressure[i] / density[i] * falloff * falloff;
+                viscosityForce.z -= 2.0f * p.velocity.z * falloff / density[i];
+            }
+            acceleration[i] = (pressureForce + viscosityForce * params.viscosity) * (mass * spiky / density[i]);
+        }
+    });
+
+    // Applied afterwards, since the pass above reads every neighbour's velocity
+    pool.parallelFor(0, count, sphGrain * 8, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++)
+            particles[i].velocity += acceleration[i] * dt;
+    });
+}
+
+/**
+ * @brief Mean density over the last step, for status output.
+ */
+float SphSolver::averageDensity() const
+{
+    double sum = 0.0;
+    for (float value : density)
+        sum += value;
+    return density.empty() ? 0.0f : (float)(sum / density.size());
+}
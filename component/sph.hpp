@@ -0,0 +1,51 @@
+#ifndef SPH_HPP
+#define SPH_HPP
+
+#include <cfloat>
+#include <vector>
+#include <glm/glm.hpp>
+#include "spatialgrid.hpp"
+
+struct Particle;
+
+/**
+ * @brief Fluid settings for SIM_SPH. Particles are spaced half a smoothing radius apart at rest.
+ */
+struct SphParams
+{
+    float smoothingRadius = 0.1f; // Kernel support, also the neighbour grid cell
+    float restDensity = 1000.0f;
+    float stiffness = 100.0f;     // Pressure per unit of excess density; its square root is the speed of sound
+    float viscosity = 0.5f;
+    float maxTimeStep = 0.0025f;  // Frames are split into substeps no longer than this
+    float groundHeight = 0.0f;    // Boundary plane, facing up
+    float groundExtent = FLT_MAX; // Half the edge of the square boundary around the origin; negative for none
+    glm::vec3 spawnMin = glm::vec3(-1.0f, -1.0f, 0.5f); // Block the fluid starts in
+    glm::vec3 spawnMax = glm::vec3(1.0f, 1.0f, 3.0f);
+
+    float spacing() const { return smoothingRadius * 0.5f; }
+    float particleMass() const { return restDensity * spacing() * spacing() * spacing(); }
+};
+
+/**
+ * @brief Smoothed particle hydrodynamics on top of the particle storage.
+ *
+ * A weakly compressible solver with the kernels of Müller et al. 2003: a
+ * density pass, then a pass adding pressure and viscosity accelerations to the
+ * velocities. Both passes are split across the thread pool and read neighbours
+ * from a SpatialGrid built over the same particles. The ground plane acts
+ * through mirrored ghost particles, so fluid resting on it keeps its density.
+ */
+class SphSolver
+{
+public:
+    void step(std::vector<Particle> &particles, const SpatialGrid &grid, const SphParams &params, float dt);
+    float averageDensity() const;
+
+private:
+    std::vector<float> density;
+    std::vector<float> pressure;
+    std::vector<glm::vec3> acceleration;
+};
+
+#endif
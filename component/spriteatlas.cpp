@@ -0,0 +1,154 @@
+#include "spriteatlas.hpp"
+#include "assetpack.hpp"
+#include "profiler.hpp"
+#include "stb_image.h"
+
+#include <stdio.h>
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+    unsigned int atlasCount = 0;
+
+    /**
+     * @brief Bilinear resample of an RGBA8 image to size x size.
+     */
+    CtexImage resample(const CtexImage &source, int size)
+    {
+        CtexImage image;
+        image.width = image.height = size;
+        image.pixels.resize((size_t)size * size * 4);
+        for (int y = 0; y < size; y++)
+        {
+            float sy = std::max(0.0f, (y + 0.5f) * source.height / size - 0.5f);
+            int y0 = std::min((int)sy, source.height - 1), y1 = std::min(y0 + 1, source.height - 1);
+            float fy = sy - y0;
+            for (int x = 0; x < size; x++)
+            {
+                float sx = std::max(0.0f, (x + 0.5f) * source.width / size - 0.5f);
+                int x0 = std::min((int)sx, source.width - 1), x1 = std::min(x0 + 1, source.width - 1);
+                float fx = sx - x0;
+                for (int c = 0; c < 4; c++)
+                {
+                    auto at = [&](int px, int py) { return (float)source.pixels[((size_t)py * source.width + px) * 4 + c]; };
+                    float top = at(x0, y0) + (at(x1, y0) - at(x0, y0)) * fx;
+                    float bottom = at(x0, y1) + (at(x1, y1) - at(x0, y1)) * fx;
+                    image.pixels[((size_t)y * size + x) * 4 + c] = (unsigned char)std::lround(top + (bottom - top) * fy);
+                }
+            }
+        }
+        return image;
+    }
+}
+
+SpriteAtlas::SpriteAtlas(int size) : edge(size), layerCount(0), label("sprite atlas " + std::to_string(++atlasCount))
+{
+}
+
+/**
+ * @brief Brings a mip chain to the layer size with a complete chain down to 1x1.
+ */
+std::vector<CtexImage> SpriteAtlas::fit(const std::vector<CtexImage> &levels) const
+{
+    if (levels[0].width == edge && levels[0].height == edge && levels.back().width == 1 && levels.back().height == 1)
+        return levels;
+    // Start from the smallest level still at least as large as the layer, so the bilinear filter doesn't alias
+    size_t level = 0;
+    while (level + 1 < levels.size() && levels[level + 1].width >= edge && levels[level + 1].height >= edge)
+        level++;
+    const CtexImage &base = levels[level].width == edge && levels[level].height == edge ? levels[level] : resample(levels[level], edge);
+    return ctexBuildMips(base);
+}
+
+/**
+ * @brief Stages a still sprite.
+ *
+ * @param levels Mip chain, largest first; a single level is enough.
+ * @return Sequence index for layer().
+ */
+int SpriteAtlas::add(const std::vector<CtexImage> &levels)
+{
+    return addSequence({levels});
+}
+
+/**
+ * @brief Stages a flipbook; its frames occupy consecutive layers.
+ *
+ * @param frames One mip chain per frame, in playback order.
+ * @return Sequence index for layer().
+ */
+int SpriteAtlas::addSequence(const std::vector<std::vector<CtexImage>> &frames)
+{
+    runs.push_back({layerCount, (int)frames.size()});
+    for (const std::vector<CtexImage> &levels : frames)
+    {
+        staged.push_back(fit(levels));
+        layerCount++;
+    }
+    return (int)runs.size() - 1;
+}
+
+/**
+ * @brief Decodes an image asset and stages it as a still sprite.
+ *
+ * @return Sequence index for layer(), or -1 if the image can't be read.
+ */
+int SpriteAtlas::addFile(const std::string &path)
+{
+    Asset asset;
+    CtexImage base;
+    int channels;
+    stbi_set_flip_vertically_on_load_thread(true);
+    unsigned char *pixels = readAsset(path, asset)
+                                ? stbi_load_from_memory(asset.data(), (int)asset.size(), &base.width, &base.height, &channels, 4)
+                                : nullptr;
+    if (!pixels)
+    {
+        fprintf(stderr, "Failed to load sprite %s\n", path.c_str());
+        return -1;
+    }
+    base.pixels.assign(pixels, pixels + (size_t)base.width * base.height * 4);
+    stbi_image_free(pixels);
+    return add({base});
+}
+
+/**
+ * @brief Uploads every staged sprite into the array texture.
+ *
+ * The CPU copies are kept, so sprites can be added and the atlas rebuilt later.
+ */
+bool SpriteAtlas::build(const TextureSampling &sampling)
+{
+    PROFILE_SCOPE("build sprite atlas");
+    if (staged.empty())
+        return false;
+    GLuint name = handle.id();
+    if (!name)
+        glGenTextures(1, &name);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, name);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    int levels = (int)staged[0].size();
+    size_t bytes = 0;
+    for (int level = 0; level < levels; level++)
+    {
+        int size = staged[0][level].width;
+        bytes += (size_t)size * size * 4 * layerCount;
+        glTexImage3D(GL_TEXTURE_2D_ARRAY, level, GL_RGBA8, size, size, layerCount, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+        for (int layer = 0; layer < layerCount; layer++)
+        {
+            glTexSubImage3D(GL_TEXTURE_2D_ARRAY, level, 0, 0, layer, size, size, 1, GL_RGBA, GL_UNSIGNED_BYTE,
+                            staged[layer][level].pixels.data());
+        }
+    }
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAX_LEVEL, levels - 1);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, sampling.minFilter);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, sampling.magFilter);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, sampling.wrap);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, sampling.wrap);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+    handle = TextureManager::instance().adopt(label, name, bytes);
+    printf("Sprite atlas: %d layers of %dx%d, %zu sequences\n", layerCount, edge, edge, runs.size());
+    return true;
+}
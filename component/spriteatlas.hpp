@@ -0,0 +1,72 @@
+#ifndef SPRITEATLAS_HPP
+#define SPRITEATLAS_HPP
+
+#include <GL/glew.h>
+#include <string>
+#include <vector>
+#include "ctex.hpp"
+#include "asynctexture.hpp"
+#include "texturemanager.hpp"
+
+/**
+ * @brief Consecutive atlas layers played back over a particle's life. A still sprite has one frame.
+ */
+struct SpriteSequence
+{
+    int firstLayer;
+    int frames;
+};
+
+/**
+ * @brief Packs equally sized sprites into the layers of one GL_TEXTURE_2D_ARRAY.
+ *
+ * Sprites are collected on the CPU with add(), addSequence() and addFile(),
+ * then uploaded together with their mip chains by build(). A particle system
+ * binds the one array texture and picks a layer per particle, so particles
+ * with different sprites or flipbook frames share a draw call. Sprites of
+ * another size are resampled to the layer size. The array texture is handed
+ * to the TextureManager, so it counts against the texture budget.
+ */
+class SpriteAtlas
+{
+public:
+    explicit SpriteAtlas(int size);
+
+    SpriteAtlas(const SpriteAtlas &) = delete;
+    SpriteAtlas &operator=(const SpriteAtlas &) = delete;
+
+    int add(const std::vector<CtexImage> &levels);
+    int addSequence(const std::vector<std::vector<CtexImage>> &frames);
+    int addFile(const std::string &path);
+    bool build(const TextureSampling &sampling = TextureSampling());
+
+    /**
+     * @brief Layer showing a sequence at a point in a particle's life.
+     *
+     * @param sequence Index returned by add(), addSequence() or addFile().
+     * @param age Fraction of the particle's lifetime elapsed, 0 to 1.
+     */
+    int layer(int sequence, float age) const
+    {
+        const SpriteSequence &run = runs[sequence];
+        int frame = (int)(age * run.frames);
+        return run.firstLayer + (frame < 0 ? 0 : frame >= run.frames ? run.frames - 1 : frame);
+    }
+
+    GLuint texture() const { return handle.id(); }
+    int size() const { return edge; }
+    int layers() const { return layerCount; }
+    const std::vector<SpriteSequence> &sequences() const { return runs; }
+
+private:
+    std::vector<CtexImage> fit(const std::vector<CtexImage> &levels) const;
+
+    int edge;
+    int layerCount;
+    std::string label; // Its TextureManager entry
+    TextureHandle handle;
+    std::vector<SpriteSequence> runs;
+    std::vector<std::vector<CtexImage>> staged; // Mip chains waiting for build()
+};
+
+#endif
@@ -0,0 +1,173 @@
+#include "spritegen.hpp"
+#include "threadpool.hpp"
+#include "profiler.hpp"
+
+#include <stdio.h>
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+    float hash(int x, int y, unsigned int seed)
+    {
+        unsigned int h = (unsigned int)x * 374761393u + (unsigned int)y * 668265263u + seed * 2246822519u;
+        h = (h ^ (h >> 13)) * 1274126177u;
+        return (h ^ (h >> 16)) / 4294967295.0f;
+    }
+
+    /**
+     * @brief Value noise in [0, 1] with smoothstep interpolation between lattice points.
+     */
+    float valueNoise(float x, float y, unsigned int seed)
+    {
+        int ix = (int)std::floor(x), iy = (int)std::floor(y);
+        float fx = x - ix, fy = y - iy;
+        fx = fx * fx * (3.0f - 2.0f * fx);
+        fy = fy * fy * (3.0f - 2.0f * fy);
+        float a = hash(ix, iy, seed), b = hash(ix + 1, iy, seed);
+        float c = hash(ix, iy + 1, seed), d = hash(ix + 1, iy + 1, seed);
+        return (a + (b - a) * fx) + ((c + (d - c) * fx) - (a + (b - a) * fx)) * fy;
+    }
+
+    float fbm(float x, float y, unsigned int seed)
+    {
+        float sum = 0.0f, amplitude = 0.5f;
+        for (int octave = 0; octave < 4; octave++)
+        {
+            sum += amplitude * valueNoise(x, y, seed + octave);
+            x *= 2.0f;
+            y *= 2.0f;
+            amplitude *= 0.5f;
+        }
+        return sum / 0.9375f;
+    }
+
+    float saturate(float v)
+    {
+        return std::min(1.0f, std::max(0.0f, v));
+    }
+
+    /**
+     * @brief RGBA of one texel; x and y run from -1 to 1 across the sprite, y up.
+     *
+     * phase runs from 0 to 1 over a flipbook: the noise scrolls upwards, flames
+     * shrink and cool, smoke spreads out.
+     */
+    void shade(const SpriteParams &params, float phase, float x, float y, float rgba[4])
+    {
+        float scroll = phase * 1.5f * params.noiseScale;
+        float n = params.noiseAmount > 0.0f ? fbm((x + 1.0f) * params.noiseScale, (y + 1.0f) * params.noiseScale - scroll, params.seed) : 0.5f;
+        switch (params.shape)
+        {
+        case SPRITE_FLAME:
+        {
+            // Narrow towards the top, and let the noise lick at the edge more higher up
+            float scale = 1.0f / (1.0f - 0.5f * phase);
+            x *= scale;
+            y *= scale;
+            float height = y * 0.5f + 0.5f;
+            float r = std::sqrt(x * x * (1.0f + 1.5f * height) * (1.0f + 1.5f * height) + y * y * 0.7f);
+            float mask = std::pow(saturate(1.0f - r + params.noiseAmount * (n - 0.5f) * (0.5f + height)), params.falloff);
+            float heat = mask * (1.0f - 0.6f * phase);
+            rgba[0] = 1.0f;
+            rgba[1] = 0.5f + 0.5f * heat;
+            rgba[2] = 0.2f + 0.8f * heat * heat;
+            rgba[3] = mask;
+            break;
+        }
+        case SPRITE_SMOKE:
+        {
+            x *= 1.0f - 0.4f * phase;
+            y *= 1.0f - 0.4f * phase;
+            float r = std::sqrt(x * x + y * y);
+            float mask = std::pow(saturate(1.0f - r), params.falloff) * (1.0f - params.noiseAmount + params.noiseAmount * n * 1.5f);
+            rgba[0] = rgba[1] = rgba[2] = 1.0f;
+            rgba[3] = saturate(mask);
+            break;
+        }
+        default:
+        {
+            float r = std::sqrt(x * x + y * y);
+            rgba[0] = rgba[1] = rgba[2] = 1.0f;
+            rgba[3] = std::pow(saturate(1.0f - r), params.falloff);
+            break;
+        }
+        }
+    }
+}
+
+/**
+ * @brief Sprite edge length in texels for a quality level.
+ */
+int spriteResolution(QualityLevel quality)
+{
+    switch (quality)
+    {
+    case QUALITY_LOW:
+        return 64;
+    case QUALITY_HIGH:
+        return 256;
+    default:
+        return 128;
+    }
+}
+
+/**
+ * @brief Unique name for a sprite, for caching and log messages.
+ */
+std::string spriteKey(const SpriteParams &params, int size)
+{
+    const char *shapes[] = {"radial", "flame", "smoke"};
+    char key[128];
+    snprintf(key, sizeof(key), "sprite:%s:%d:%g:%g:%g:%u", shapes[params.shape], size,
+             params.falloff, params.noiseScale, params.noiseAmount, params.seed);
+    return key;
+}
+
+/**
+ * @brief Renders a sprite and its full mip chain as RGBA8, rows spread over the thread pool.
+ *
+ * @param params Shape and noise parameters.
+ * @param size Edge length of level 0 in texels.
+ * @param phase Animation phase from 0 to 1, see generateFlipbook().
+ */
+std::vector<CtexImage> generateSprite(const SpriteParams &params, int size, float phase)
+{
+    PROFILE_SCOPE("generate sprite");
+    CtexImage base;
+    base.width = base.height = size;
+    base.pixels.resize((size_t)size * size * 4);
+    ThreadPool::shared().parallelFor(0, size, 16, [&](size_t begin, size_t end) {
+        for (size_t row = begin; row < end; row++)
+        {
+            float y = (row + 0.5f) / size * 2.0f - 1.0f;
+            for (int column = 0; column < size; column++)
+            {
+                float x = (column + 0.5f) / size * 2.0f - 1.0f;
+                float rgba[4];
+                shade(params, phase, x, y, rgba);
+                unsigned char *texel = &base.pixels[(row * size + column) * 4];
+                for (int c = 0; c < 4; c++)
+                    texel[c] = (unsigned char)std::lround(saturate(rgba[c]) * 255.0f);
+            }
+        }
+    });
+    return ctexBuildMips(base);
+}
+
+/**
+ * @brief Renders the frames of an animated sprite, from birth to death of a particle.
+ *
+ * @param frames Number of frames; each is a full mip chain.
+ * @return One mip chain per frame.
+ */
+std::vector<std::vector<CtexImage>> generateFlipbook(const SpriteParams &params, int size, int frames)
+{
+    PROFILE_SCOPE("generate flipbook");
+    std::vector<std::vector<CtexImage>> chains(frames);
+    ThreadPool::shared().parallelFor(0, frames, 1, [&](size_t begin, size_t end) {
+        for (size_t frame = begin; frame < end; frame++)
+            chains[frame] = generateSprite(params, size, frames > 1 ? (float)frame / (frames - 1) : 0.0f);
+    });
+    return chains;
+}
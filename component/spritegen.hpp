@@ -0,0 +1,42 @@
+#ifndef SPRITEGEN_HPP
+#define SPRITEGEN_HPP
+
+#include <string>
+#include <vector>
+#include "ctex.hpp"
+
+enum SpriteShape
+{
+    SPRITE_RADIAL, // Smooth round falloff
+    SPRITE_FLAME,  // Teardrop with a hot core, edge broken up by noise
+    SPRITE_SMOKE,  // Soft billowy puff
+};
+
+/**
+ * @brief Rendering quality; picks the resolution of generated sprites.
+ */
+enum QualityLevel
+{
+    QUALITY_LOW,
+    QUALITY_MEDIUM,
+    QUALITY_HIGH,
+};
+
+/**
+ * @brief Parameters of a procedural particle sprite.
+ */
+struct SpriteParams
+{
+    SpriteShape shape = SPRITE_FLAME;
+    float falloff = 1.5f;     // Exponent of the edge falloff; higher is a smaller, harder core
+    float noiseScale = 4.0f;  // Noise frequency across the sprite
+    float noiseAmount = 0.4f; // 0 for a clean shape
+    unsigned int seed = 1;
+};
+
+int spriteResolution(QualityLevel quality);
+std::string spriteKey(const SpriteParams &params, int size);
+std::vector<CtexImage> generateSprite(const SpriteParams &params, int size, float phase = 0.0f);
+std::vector<std::vector<CtexImage>> generateFlipbook(const SpriteParams &params, int size, int frames);
+
+#endif
@@ -1,21 +1,23 @@
 #include "texture.hpp"
+#include "profiler.hpp"
+#include "assetpack.hpp"
 
 /**
  * @brief Loads a texture from a file and generates an OpenGL texture object.
  *
  * This function loads an image from the specified file path, creates an OpenGL texture object,
- * and sets the necessary texture parameters. It also exports the loaded texture to a PNG file
- * for verification purposes.
+ * and sets the necessary texture parameters. When texture dumps are enabled (see texturedump.hpp)
+ * a PNG copy is written in the background for verification purposes.
  *
  * @param texturePath The file path to the texture image.
  * @return The OpenGL texture ID of the loaded texture.
  *
  * The function performs the following steps:
  * - Generates a texture ID and binds it to GL_TEXTURE_2D.
- * - Loads the image data using the stb_image library.
- * - If the image is successfully loaded, it exports the texture to a PNG file and logs the texture details.
+ * - Loads the image data using the stb_image library, from the asset pack or the loose file.
+ * - Flips the image vertically while decoding it.
+ * - If the image is successfully loaded, it queues the optional debug dump and logs the texture details.
  * - Sets the texture format based on the number of channels in the image.
- * - Flips the image vertically before uploading it to the GPU.
  * - Uploads the image data to the GPU and generates mipmaps.
  * - Sets texture wrapping parameters to GL_CLAMP_TO_EDGE.
  * - Frees the image data after uploading it to the GPU.
@@ -24,27 +26,46 @@
  */
 GLuint loadTexture(const char *texturePath)
 {
+	Asset asset;
+	readAsset(texturePath, asset);
+	return loadTexture(asset.data(), asset.size(), texturePath);
+}
+
+/**
+ * @brief Same as loadTexture(const char *), but decodes an image file already in memory.
+ *
+ * @param fileData Encoded image file contents, e.g. an embedded asset.
+ * @param fileSize Size of fileData in bytes.
+ * @param label Name used in log messages and for the debug dump.
+ * @return The OpenGL texture ID of the loaded texture.
+ */
+GLuint loadTexture(const unsigned char *fileData, size_t fileSize, const char *label)
+{
+	PROFILE_SCOPE("loadTexture");
 	GLuint textureID;
 	glGenTextures(1, &textureID);
 	glBindTexture(GL_TEXTURE_2D, textureID);
 
 	int width, height, nrChannels;
-	unsigned char *data = stbi_load(texturePath, &width, &height, &nrChannels, 0);
+	stbi_set_flip_vertically_on_load_thread(true);
+	unsigned char *data = NULL;
+	if (fileData)
+	{
+		data = stbi_load_from_memory(fileData, (int)fileSize, &width, &height, &nrChannels, 0);
+	}
 	if (data)
 	{
-		stbi_write_png("../test/output_texture.png", width, height, nrChannels, data, width * nrChannels);
-    	std::cout << "Texture exported to output_texture.png" << std::endl;
+		dumpTexture(label, width, height, nrChannels, data);
 		GLenum format = (nrChannels == 4) ? GL_RGBA : GL_RGB;
-		std::cout << "Texture loaded: " << texturePath
+		std::cout << "Texture loaded: " << label
 				  << " (Width: " << width << ", Height: " << height
 				  << ", Channels: " << nrChannels << ")" << std::endl;
-		stbi_set_flip_vertically_on_load(true);
 		glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
 		glGenerateMipmap(GL_TEXTURE_2D);
 	}
 	else
 	{
-		std::cerr << "Failed to load texture: " << texturePath << std::endl;
+		std::cerr << "Failed to load texture: " << label << std::endl;
 	}
 	stbi_image_free(data);
 
@@ -3,8 +3,9 @@
 #include <GL/glew.h>
 #include <iostream>
 #include "stb_image.h"
-#include "stb_image_write.h"
+#include "texturedump.hpp"
 
 GLuint loadTexture(const char *texturePath);
+GLuint loadTexture(const unsigned char *fileData, size_t fileSize, const char *label);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,91 @@
+#include "texturedump.hpp"
+#include "threadpool.hpp"
+#include "profiler.hpp"
+#include "stb_image_write.h"
+
+#include <stdio.h>
+#include <cstring>
+#include <filesystem>
+#include <mutex>
+#include <vector>
+
+namespace
+{
+    std::mutex dumpMutex;
+    std::string dumpDirectory;
+
+    /**
+     * @brief Turns a texture path into a flat file name: leading ./ and ../ dropped,
+     * separators replaced by '_', extension swapped for .png.
+     */
+    std::string dumpFileName(const std::string &texturePath)
+    {
+        std::string name = texturePath;
+        while (name.compare(0, 2, "./") == 0 || name.compare(0, 3, "../") == 0)
+        {
+            name.erase(0, name[1] == '/' ? 2 : 3);
+        }
+        size_t slash = name.find_last_of("/\\");
+        size_t dot = name.find_last_of('.');
+        if (dot != std::string::npos && (slash == std::string::npos || dot > slash))
+            name.erase(dot);
+        for (char &c : name)
+        {
+            if (c == '/' || c == '\\' || c == ':')
+                c = '_';
+        }
+        return name + ".png";
+    }
+}
+
+/**
+ * @brief Enables dumps into the given directory; an empty string disables them.
+ */
+void setTextureDumpDirectory(const std::string &directory)
+{
+    std::lock_guard<std::mutex> lock(dumpMutex);
+    dumpDirectory = directory;
+}
+
+bool textureDumpEnabled()
+{
+    std::lock_guard<std::mutex> lock(dumpMutex);
+    return !dumpDirectory.empty();
+}
+
+/**
+ * @brief Queues a PNG dump of a decoded image. Does nothing while dumps are disabled.
+ *
+ * @param texturePath Source file, used to name the dump.
+ * @param pixels Tightly packed rows, bottom row first as uploaded to GL; copied before returning.
+ */
+void dumpTexture(const std::string &texturePath, int width, int height, int channels, const unsigned char *pixels)
+{
+    std::string directory;
+    {
+        std::lock_guard<std::mutex> lock(dumpMutex);
+        directory = dumpDirectory;
+    }
+    if (directory.empty() || !pixels)
+        return;
+
+    // Store top row first so the PNG looks like the source image. Flipping the
+    // copy ourselves avoids stb's process-wide flip-on-write flag.
+    size_t stride = (size_t)width * channels;
+    std::vector<unsigned char> flipped(stride * height);
+    for (int y = 0; y < height; y++)
+    {
+        memcpy(&flipped[(size_t)y * stride], pixels + (size_t)(height - 1 - y) * stride, stride);
+    }
+
+    std::string path = directory + "/" + dumpFileName(texturePath);
+    ThreadPool::shared().submit([directory, path, width, height, channels, stride, flipped = std::move(flipped)] {
+        PROFILE_SCOPE("dump texture");
+        std::error_code error;
+        std::filesystem::create_directories(directory, error);
+        if (stbi_write_png(path.c_str(), width, height, channels, flipped.data(), (int)stride))
+            printf("Texture dumped to %s\n", path.c_str());
+        else
+            fprintf(stderr, "Failed to dump texture to %s\n", path.c_str());
+    });
+}
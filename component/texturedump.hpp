@@ -0,0 +1,17 @@
+#ifndef TEXTUREDUMP_HPP
+#define TEXTUREDUMP_HPP
+
+#include <string>
+
+/**
+ * @brief Optional PNG dumps of decoded textures, for checking what the loader produced.
+ *
+ * Disabled until a directory is set. Each dump copies the pixels and encodes
+ * them on the shared ThreadPool, so enabling it never stalls the loader.
+ * Files are named after the source path, e.g. ../texture/Fire.jpg -> texture_Fire.png.
+ */
+void setTextureDumpDirectory(const std::string &directory);
+bool textureDumpEnabled();
+void dumpTexture(const std::string &texturePath, int width, int height, int channels, const unsigned char *pixels);
+
+#endif
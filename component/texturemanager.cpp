@@ -0,0 +1,351 @@
+#include "texturemanager.hpp"
+#include "cookedtexture.hpp"
+#include "assetpack.hpp"
+#include "spritegen.hpp"
+
+#include <stdio.h>
+#include <filesystem>
+
+struct TextureHandle::Entry
+{
+    std::string path;
+    GLuint texture;
+    size_t bytes;
+    unsigned int references;
+    unsigned long long lastReleased;
+    bool loaded; // The streamed upload has landed; until then the name must stay alive
+    bool mipmapped;
+};
+
+TextureHandle::TextureHandle(const TextureHandle &other) : entry(other.entry)
+{
+    if (entry)
+        entry->references++;
+}
+
+TextureHandle &TextureHandle::operator=(TextureHandle other)
+{
+    std::swap(entry, other.entry);
+    return *this;
+}
+
+TextureHandle::~TextureHandle()
+{
+    reset();
+}
+
+GLuint TextureHandle::id() const
+{
+    return entry ? entry->texture : 0;
+}
+
+/**
+ * @brief Drops this reference; the texture becomes evictable once no handle refers to it.
+ */
+void TextureHandle::reset()
+{
+    if (entry)
+        TextureManager::instance().release(entry);
+    entry = nullptr;
+}
+
+TextureManager::TextureManager()
+    : cookedDirectory("cooked"), budget((size_t)256 << 20), bytes(0), clock(0), hits(0), misses(0), evictions(0)
+{
+    AsyncTextureLoader::instance().onUploaded = [this](GLuint texture, int width, int height) {
+        uploaded(texture, width, height);
+    };
+}
+
+TextureManager &TextureManager::instance()
+{
+    static TextureManager manager;
+    return manager;
+}
+
+std::string TextureManager::samplingSuffix(const TextureSampling &sampling)
+{
+    char parameters[64];
+    snprintf(parameters, sizeof(parameters), "|%x|%x|%x", sampling.wrap, sampling.minFilter, sampling.magFilter);
+    return parameters;
+}
+
+std::string TextureManager::key(const std::string &path, const TextureSampling &sampling)
+{
+    std::string parameters = samplingSuffix(sampling);
+    // Built-in assets have one name already; only loose files need the filesystem to resolve theirs
+    if (assetBuiltIn(path))
+        return assetName(path) + parameters;
+    std::error_code error;
+    std::filesystem::path canonical = std::filesystem::weakly_canonical(path, error);
+    return (error ? path : canonical.string()) + parameters;
+}
+
+/**
+ * @brief Returns a handle to the texture, loading it on first use.
+ *
+ * Prefers an up-to-date cooked copy from the cooked directory over decoding the image.
+ *
+ * @param path Image file path; different spellings of the same file share one texture.
+ * @param sampling Wrap and filter modes. Each combination is a separate texture object.
+ */
+TextureHandle TextureManager::acquire(const std::string &path, const TextureSampling &sampling)
+{
+    std::string entryKey = key(path, sampling);
+    auto found = entries.find(entryKey);
+    if (found != entries.end() && found->second->texture != 0)
+    {
+        hits++;
+        found->second->references++;
+        return TextureHandle(found->second.get());
+    }
+
+    misses++;
+    std::unique_ptr<TextureHandle::Entry> entry(new TextureHandle::Entry());
+    entry->path = path;
+    entry->texture = 0;
+    entry->references = 1;
+    entry->lastReleased = 0;
+    entry->mipmapped = sampling.minFilter != GL_LINEAR && sampling.minFilter != GL_NEAREST;
+
+    // A cooked file already has its mip chain and is cheap to upload, so load it right away.
+    // Loose cooked files are not looked for when the source is built in, so cold start stays off the disk.
+    std::string cooked = cookedTexturePath(cookedDirectory, path);
+    if (!cookedDirectory.empty() && (assetBuiltIn(cooked) || (!assetBuiltIn(path) && cookedTextureCurrent(cooked, path))))
+    {
+        glGenTextures(1, &entry->texture);
+        entry->bytes = loadCookedTexture(cooked, entry->texture, sampling);
+        entry->loaded = entry->bytes > 0;
+        if (!entry->loaded)
+        {
+            glDeleteTextures(1, &entry->texture);
+            entry->texture = 0;
+        }
+    }
+    if (entry->texture == 0)
+    {
+        entry->texture = AsyncTextureLoader::instance().request(path, sampling);
+        entry->bytes = 4; // 1x1 placeholder
+        entry->loaded = false;
+    }
+    return insert(entryKey, std::move(entry));
+}
+
+/**
+ * @brief Returns a handle to a procedural sprite, generating it on the thread pool on first use.
+ *
+ * @param params Sprite shape and noise parameters.
+ * @param size Edge length of the largest mip level in texels.
+ * @param sampling Wrap and filter modes. Generated sprites always carry a full mip chain.
+ */
+TextureHandle TextureManager::acquireSprite(const SpriteParams &params, int size, const TextureSampling &sampling)
+{
+    std::string label = spriteKey(params, size);
+    std::string entryKey = label + samplingSuffix(sampling);
+    auto found = entries.find(entryKey);
+    if (found != entries.end() && found->second->texture != 0)
+    {
+        hits++;
+        found->second->references++;
+        return TextureHandle(found->second.get());
+    }
+
+    misses++;
+    std::unique_ptr<TextureHandle::Entry> entry(new TextureHandle::Entry());
+    entry->path = label;
+    entry->references = 1;
+    entry->lastReleased = 0;
+    entry->mipmapped = true;
+    entry->texture = AsyncTextureLoader::instance().generate(label, [params, size] { return generateSprite(params, size); }, sampling);
+    entry->bytes = 4; // 1x1 placeholder
+    entry->loaded = false;
+    return insert(entryKey, std::move(entry));
+}
+
+/**
+ * @brief Takes over a texture built elsewhere, such as a sprite atlas, so it counts against the budget.
+ *
+ * The manager owns the texture from then on and deletes it like any other
+ * once it is unreferenced and evicted. Adopting the same texture under the
+ * same label again, after it has been re-uploaded, just updates its size.
+ *
+ * @param label Unique name for the entry; no file is read.
+ * @param size Estimated GPU memory in bytes.
+ */
+TextureHandle TextureManager::adopt(const std::string &label, GLuint texture, size_t size)
+{
+    auto found = entries.find(label);
+    if (found != entries.end() && found->second->texture == texture)
+    {
+        TextureHandle::Entry &entry = *found->second;
+        bytes = bytes - entry.bytes + size;
+        entry.bytes = size;
+        entry.references++;
+        trim();
+        return TextureHandle(&entry);
+    }
+
+    std::unique_ptr<TextureHandle::Entry> entry(new TextureHandle::Entry());
+    entry->path = label;
+    entry->texture = texture;
+    entry->bytes = size;
+    entry->references = 1;
+    entry->lastReleased = 0;
+    entry->loaded = true;
+    entry->mipmapped = true;
+    TextureHandle handle = insert(label, std::move(entry));
+    trim();
+    return handle;
+}
+
+/**
+ * @brief Stores a freshly loaded entry and returns the first handle to it.
+ */
+TextureHandle TextureManager::insert(const std::string &entryKey, std::unique_ptr<TextureHandle::Entry> entry)
+{
+    bytes += entry->bytes;
+
+    TextureHandle handle(entry.get());
+    auto found = entries.find(entryKey);
+    if (found != entries.end())
+    {
+        // Handles still point at a cleared entry; give them the new texture too
+        entry->references += found->second->references;
+        *found->second = *entry;
+        handle.entry = found->second.get();
+    }
+    else
+    {
+        entries[entryKey] = std::move(entry);
+    }
+    return handle;
+}
+
+void TextureManager::release(TextureHandle::Entry *entry)
+{
+    if (--entry->references == 0)
+    {
+        entry->lastReleased = ++clock;
+        trim();
+    }
+}
+
+/**
+ * @brief Records the real size of a streamed texture once its upload lands.
+ */
+void TextureManager::uploaded(GLuint texture, int width, int height)
+{
+    for (auto &it : entries)
+    {
+        TextureHandle::Entry &entry = *it.second;
+        if (entry.texture != texture)
+            continue;
+        if (width > 0 && height > 0)
+        {
+            // Drivers store RGB8 padded to four bytes; a full mip chain adds a third
+            size_t size = (size_t)width * height * 4;
+            bytes -= entry.bytes;
+            entry.bytes = entry.mipmapped ? size + size / 3 : size;
+            bytes += entry.bytes;
+        }
+        entry.loaded = true;
+        break;
+    }
+    trim();
+}
+
+/**
+ * @brief Sets where acquire() looks for texcook output; an empty string disables cooked textures.
+ */
+void TextureManager::setCookedDirectory(const std::string &directory)
+{
+    cookedDirectory = directory;
+}
+
+/**
+ * @brief Sets the GPU memory budget in bytes and evicts down to it.
+ */
+void TextureManager::setBudget(size_t budget)
+{
+    this->budget = budget;
+    trim();
+}
+
+void TextureManager::evict(std::map<std::string, std::unique_ptr<TextureHandle::Entry>>::iterator it)
+{
+    glDeleteTextures(1, &it->second->texture);
+    bytes -= it->second->bytes;
+    evictions++;
+    entries.erase(it);
+}
+
+/**
+ * @brief Deletes unreferenced textures, least recently released first, until within budget.
+ */
+void TextureManager::trim()
+{
+    while (bytes > budget)
+    {
+        auto victim = entries.end();
+        for (auto it = entries.begin(); it != entries.end(); ++it)
+        {
+            const TextureHandle::Entry &entry = *it->second;
+            if (entry.references == 0 && entry.loaded &&
+                (victim == entries.end() || entry.lastReleased < victim->second->lastReleased))
+            {
+                victim = it;
+            }
+        }
+        if (victim == entries.end())
+            return;
+        evict(victim);
+    }
+}
+
+TextureStats TextureManager::stats() const
+{
+    TextureStats stats;
+    for (const auto &it : entries)
+    {
+        const TextureHandle::Entry &entry = *it.second;
+        if (entry.texture == 0)
+            continue;
+        stats.textures++;
+        if (entry.references > 0)
+        {
+            stats.referenced++;
+            stats.referencedBytes += entry.bytes;
+        }
+        if (!entry.loaded)
+            stats.pending++;
+    }
+    stats.bytes = bytes;
+    stats.budget = budget;
+    stats.hits = hits;
+    stats.misses = misses;
+    stats.evictions = evictions;
+    return stats;
+}
+
+/**
+ * @brief Deletes every texture. Handles that are still alive read as 0 afterwards.
+ *
+ * Waits for streaming uploads first so no upload lands in a deleted name.
+ */
+void TextureManager::clear()
+{
+    AsyncTextureLoader::instance().finish();
+    for (auto it = entries.begin(); it != entries.end();)
+    {
+        TextureHandle::Entry &entry = *it->second;
+        if (entry.texture != 0)
+            glDeleteTextures(1, &entry.texture);
+        entry.texture = 0;
+        entry.bytes = 0;
+        if (entry.references == 0)
+            it = entries.erase(it);
+        else
+            ++it;
+    }
+    bytes = 0;
+}
@@ -0,0 +1,103 @@
+#ifndef TEXTUREMANAGER_HPP
+#define TEXTUREMANAGER_HPP
+
+#include <GL/glew.h>
+#include <cstddef>
+#include <map>
+#include <memory>
+#include <string>
+#include "asynctexture.hpp"
+#include "spritegen.hpp"
+
+/**
+ * @brief Texture memory counters, see TextureManager::stats().
+ */
+struct TextureStats
+{
+    unsigned int textures = 0;   // Resident, referenced or cached
+    unsigned int referenced = 0; // Held by at least one handle
+    unsigned int pending = 0;    // Requested, upload not landed yet
+    size_t bytes = 0;            // Estimated GPU memory of all resident textures
+    size_t referencedBytes = 0;
+    size_t budget = 0;
+    unsigned long long hits = 0;
+    unsigned long long misses = 0;
+    unsigned long long evictions = 0;
+};
+
+class TextureManager;
+
+/**
+ * @brief Shared reference to a managed texture. The texture stays resident while any copy exists.
+ */
+class TextureHandle
+{
+public:
+    TextureHandle() : entry(nullptr) {}
+    TextureHandle(const TextureHandle &other);
+    TextureHandle(TextureHandle &&other) noexcept : entry(other.entry) { other.entry = nullptr; }
+    TextureHandle &operator=(TextureHandle other);
+    ~TextureHandle();
+
+    GLuint id() const;
+    explicit operator bool() const { return id() != 0; }
+    void reset();
+
+private:
+    friend class TextureManager;
+    struct Entry;
+    explicit TextureHandle(Entry *entry) : entry(entry) {}
+
+    Entry *entry;
+};
+
+/**
+ * @brief Loads each texture once and shares it between every user.
+ *
+ * Textures are keyed by their canonical path and sampling parameters, and
+ * stream in through AsyncTextureLoader unless texcook has produced a .ctex
+ * for them, which is uploaded immediately. Procedural sprites are keyed by
+ * their parameters and generated on the thread pool. When the last handle goes away the
+ * texture stays cached; once the estimated GPU memory exceeds the budget,
+ * the least recently released unreferenced textures are deleted. Referenced
+ * textures are never evicted, so the budget can be exceeded while they are
+ * in use. Call clear() before the GL context is destroyed.
+ */
+class TextureManager
+{
+public:
+    static TextureManager &instance();
+
+    TextureHandle acquire(const std::string &path, const TextureSampling &sampling = TextureSampling());
+    TextureHandle acquireSprite(const SpriteParams &params, int size, const TextureSampling &sampling = TextureSampling());
+    TextureHandle adopt(const std::string &label, GLuint texture, size_t size);
+
+    void setCookedDirectory(const std::string &directory);
+    void setBudget(size_t bytes);
+    TextureStats stats() const;
+    void clear();
+
+private:
+    friend class TextureHandle;
+
+    TextureManager();
+
+    static std::string samplingSuffix(const TextureSampling &sampling);
+    static std::string key(const std::string &path, const TextureSampling &sampling);
+    TextureHandle insert(const std::string &entryKey, std::unique_ptr<TextureHandle::Entry> entry);
+    void release(TextureHandle::Entry *entry);
+    void uploaded(GLuint texture, int width, int height);
+    void trim();
+    void evict(std::map<std::string, std::unique_ptr<TextureHandle::Entry>>::iterator it);
+
+    std::map<std::string, std::unique_ptr<TextureHandle::Entry>> entries;
+    std::string cookedDirectory;
+    size_t budget;
+    size_t bytes;
+    unsigned long long clock;
+    unsigned long long hits;
+    unsigned long long misses;
+    unsigned long long evictions;
+};
+
+#endif
@@ -0,0 +1,158 @@
+#include "threadpool.hpp"
+#include "profiler.hpp"
+
+#include <stdio.h>
+#include <algorithm>
+#include <atomic>
+#include <memory>
+
+#ifdef __linux__
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+/**
+ * @brief Starts the worker threads and waits until each has recorded its thread id.
+ *
+ * @param threads Number of workers. With 0 every job runs on the submitting thread.
+ */
+ThreadPool::ThreadPool(unsigned int threads) : ids(threads, 0), started(0), stopping(false)
+{
+    for (unsigned int i = 0; i < threads; i++)
+    {
+        workers.emplace_back(&ThreadPool::run, this, i);
+    }
+    std::unique_lock<std::mutex> lock(mutex);
+    ready.wait(lock, [this, threads] { return started == threads; });
+}
+
+/**
+ * @brief Finishes every queued job, then joins the workers.
+ */
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (std::thread &worker : workers)
+    {
+        worker.join();
+    }
+}
+
+/**
+ * @brief Returns the process-wide pool, sized to leave one core for the main thread.
+ */
+ThreadPool &ThreadPool::shared()
+{
+    static ThreadPool pool(std::max(1u, std::thread::hardware_concurrency()) - 1);
+    return pool;
+}
+
+void ThreadPool::run(unsigned int index)
+{
+    char name[32];
+    snprintf(name, sizeof(name), "worker %u", index);
+    PROFILE_THREAD_NAME(name);
+    (void)name;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+#ifdef __linux__
+        ids[index] = (long)syscall(SYS_gettid);
+#endif
+        started++;
+    }
+    ready.notify_one();
+
+    for (;;)
+    {
+        std::function<void()> task;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wake.wait(lock, [this] { return stopping || !tasks.empty(); });
+            if (tasks.empty())
+                return;
+            task = std::move(tasks.front());
+            tasks.pop_front();
+        }
+        PROFILE_SCOPE("pool task");
+        task();
+    }
+}
+
+/**
+ * @brief Queues a job to run on a worker thread.
+ */
+void ThreadPool::submit(std::function<void()> task)
+{
+    if (workers.empty())
+    {
+        task();
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        tasks.push_back(std::move(task));
+    }
+    wake.notify_one();
+}
+
+/**
+ * @brief Runs body over [begin, end) in chunks of about grain indices and waits for all of them.
+ *
+ * The calling thread claims chunks too, so nesting parallelFor inside a pool
+ * job cannot deadlock: whatever the workers don't pick up, the caller runs.
+ *
+ * @param begin First index.
+ * @param end One past the last index.
+ * @param grain Minimum chunk size; keep it large enough to amortize scheduling.
+ * @param body Called as body(chunkBegin, chunkEnd), possibly concurrently.
+ */
+void ThreadPool::parallelFor(size_t begin, size_t end, size_t grain, const std::function<void(size_t, size_t)> &body)
+{
+    if (end <= begin)
+        return;
+    grain = std::max<size_t>(grain, 1);
+    size_t chunks = (end - begin + grain - 1) / grain;
+    if (chunks == 1 || workers.empty())
+    {
+        body(begin, end);
+        return;
+    }
+
+    struct Shared
+    {
+        std::atomic<size_t> next{0};
+        std::atomic<size_t> done{0};
+        std::mutex mutex;
+        std::condition_variable finished;
+    };
+    std::shared_ptr<Shared> shared = std::make_shared<Shared>();
+
+    // The body reference stays valid: we don't return before every chunk is done
+    auto work = [shared, &body, begin, end, grain, chunks]() {
+        size_t chunk;
+        while ((chunk = shared->next.fetch_add(1)) < chunks)
+        {
+            size_t chunkBegin = begin + chunk * grain;
+            body(chunkBegin, std::min(end, chunkBegin + grain));
+            if (shared->done.fetch_add(1) + 1 == chunks)
+            {
+                std::lock_guard<std::mutex> lock(shared->mutex);
+                shared->finished.notify_all();
+            }
+        }
+    };
+
+    size_t helpers = std::min<size_t>(workers.size(), chunks - 1);
+    for (size_t i = 0; i < helpers; i++)
+    {
+        submit(work);
+    }
+    work();
+
+    std::unique_lock<std::mutex> lock(shared->mutex);
+    shared->finished.wait(lock, [&shared, chunks] { return shared->done.load() == chunks; });
+}
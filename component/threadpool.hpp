@@ -0,0 +1,49 @@
+#ifndef THREADPOOL_HPP
+#define THREADPOOL_HPP
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief Fixed set of worker threads for background jobs and data-parallel loops.
+ *
+ * submit() queues fire-and-forget jobs; parallelFor() splits an index range into
+ * chunks that the workers and the calling thread process together, and returns
+ * once every chunk is done. Every job is a profiler scope on its worker's track.
+ */
+class ThreadPool
+{
+public:
+    explicit ThreadPool(unsigned int threads);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool &) = delete;
+    ThreadPool &operator=(const ThreadPool &) = delete;
+
+    static ThreadPool &shared();
+
+    unsigned int size() const { return (unsigned int)workers.size(); }
+    const std::vector<long> &threadIds() const { return ids; }
+
+    void submit(std::function<void()> task);
+    void parallelFor(size_t begin, size_t end, size_t grain, const std::function<void(size_t, size_t)> &body);
+
+private:
+    void run(unsigned int index);
+
+    std::vector<std::thread> workers;
+    std::vector<long> ids; // Kernel thread id of each worker, for per-thread counters; 0 where unknown
+    unsigned int started;
+    std::deque<std::function<void()>> tasks;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable ready;
+    bool stopping;
+};
+
+#endif
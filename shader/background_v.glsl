@@ -3,9 +3,10 @@ layout(location = 0) in vec3 vertexPosition_modelspace;
 layout(location = 1) in vec2 vertexUV; 
 
 uniform mat4 MVP;
+uniform float SCALE;
 out vec2 uvCoords;
 
 void main() {
     uvCoords = vertexUV;
-    gl_Position = MVP * vec4(vertexPosition_modelspace, 1.0);
+    gl_Position = MVP * vec4(vertexPosition_modelspace * SCALE, 1.0);
 }
\ No newline at end of file
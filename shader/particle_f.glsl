@@ -1,15 +1,28 @@
 #version 330 core
+#include "sprite.glsl"
 
 in vec2 uvCoords; 
+in vec4 particleColor;
+flat in float spriteLayer;
 out vec4 FragColor;
 
+#ifdef ATLAS
+uniform sampler2DArray Texture; 
+#else
 uniform sampler2D Texture; 
-uniform vec4 color;          
+#endif
 
 void main()
 {
-    
-    vec4 textureColor = texture(Texture, uvCoords);
+    vec4 textureColor = vec4(1.0);
+#if defined(TEXTURED) && defined(ATLAS)
+    textureColor = texture(Texture, vec3(uvCoords, spriteLayer));
+#elif defined(TEXTURED)
+    textureColor = texture(Texture, uvCoords);
+#endif
+#ifdef SOFT
+    textureColor.a *= softFalloff(uvCoords);
+#endif
     // vec4 textureColor = vec4(uvCoords, 0.0, 1.0);
-    FragColor = color*textureColor;
+    FragColor = particleColor*textureColor;
 }
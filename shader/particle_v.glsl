@@ -2,23 +2,43 @@
 
 layout(location = 0) in vec3 vertexPosition_modelspace;
 layout(location = 1) in vec2 vertexUV; 
+// Per particle, advanced once per instance. Half floats and normalized
+// integers are decoded by the vertex fetch, see instancelayout.hpp
+layout(location = 2) in vec3 instancePosition;
+layout(location = 3) in float instanceSize;
+layout(location = 4) in vec4 instanceColor;
+layout(location = 5) in float instanceAge; // Fraction of the lifetime elapsed
+layout(location = 6) in float instanceLayer; // Sprite atlas layer
 
 
 uniform mat4 MVP;
-uniform float SIZE;
-uniform vec3 OF;
+#ifdef LIFE_CURVES
+// Layer 0: color multiplier and alpha, layer 1: size multiplier in r
+uniform sampler1DArray LifeCurves;
+#endif
 
 out vec2 uvCoords;
+out vec4 particleColor;
+flat out float spriteLayer;
 
 
 void main()
 {
-    vec3 scaled_modelspace = vertexPosition_modelspace*SIZE;
-    vec3 translated_modelspace = scaled_modelspace+OF;
+    float size = instanceSize;
+    particleColor = instanceColor;
+#ifdef LIFE_CURVES
+    // Texel i holds age i/(n-1); map the age onto texel centres
+    float lutSize = float(textureSize(LifeCurves, 0).x);
+    float u = (instanceAge * (lutSize - 1.0) + 0.5) / lutSize;
+    particleColor *= texture(LifeCurves, vec2(u, 0.0));
+    size *= texture(LifeCurves, vec2(u, 1.0)).r;
+#endif
+    vec3 scaled_modelspace = vertexPosition_modelspace*size;
+    vec3 translated_modelspace = scaled_modelspace+instancePosition;
     uvCoords = vertexUV;
+    spriteLayer = instanceLayer;
     // uvCoords = (vertexPosition_modelspace.xy + vec2(1.0)) * 0.5;
     // uvCoords = (translated_modelspace.xy + vec2(1.0)) * 0.5;
     gl_Position = MVP * vec4(translated_modelspace, 1.0);
 }
 
-
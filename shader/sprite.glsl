@@ -0,0 +1,8 @@
+// Helpers shared by the sprite shaders. Include after #version.
+
+// Radial falloff for the SOFT variant: 1 in the middle of the sprite, 0 at its edge
+float softFalloff(vec2 uv)
+{
+    float d = length(uv * 2.0 - 1.0);
+    return 1.0 - smoothstep(0.5, 1.0, d);
+}
@@ -0,0 +1,45 @@
+/**
+ * @file assetpack.cpp
+ * @brief Builds the asset pack read by the viewer.
+ *
+ * Files are stored under their path relative to the current root, which
+ * starts as the working directory and is changed with -C, like tar:
+ *
+ *     assetpack assets.pak -C .. shader/particle_v.glsl texture/Fire.jpg -C . cooked/texture/Fire.jpg.ctex
+ *
+ * Usage: assetpack <output> [-C <root>] <files...>
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include "../component/assetpack.hpp"
+
+int main(int argc, char **argv)
+{
+    if (argc < 3)
+    {
+        fprintf(stderr, "Usage: %s <output> [-C <root>] <files...>\n", argv[0]);
+        return -1;
+    }
+
+    std::string root = ".";
+    std::vector<std::string> names;
+    std::vector<std::string> files;
+    for (int i = 2; i < argc; i++)
+    {
+        if (strcmp(argv[i], "-C") == 0 && i + 1 < argc)
+        {
+            root = argv[++i];
+            continue;
+        }
+        names.push_back(assetName(argv[i]));
+        files.push_back(root + "/" + argv[i]);
+    }
+
+    if (!assetPackWrite(argv[1], names, files))
+        return 1;
+    printf("%s: %zu files\n", argv[1], names.size());
+    return 0;
+}
@@ -10,11 +10,33 @@
  * @date 2025
  */
 
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <iostream>
+#include <GL/glew.h>
+#include <GLFW/glfw3.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include "../component/particlesys.hpp"
+#include "../component/camera.hpp"
+#include "../component/background.hpp"
+#include "../component/shader.hpp"
+#include "../component/profiler.hpp"
+#include "../component/frametimer.hpp"
+#include "../component/shaderreload.hpp"
+#include "../component/asynctexture.hpp"
+#include "../component/assetpack.hpp"
+#include "../component/embeddedassets.hpp"
+
  /**
     * @brief Key callback function to handle key press events.
     * 
     * This function is called whenever a key is pressed or released.
-    * It closes the window if the Escape or Q key is pressed.
+    * It closes the window if the Escape or Q key is pressed, prints the
+    * particle system's status if the P key is pressed and toggles the soft
+    * particle shader variant if the S key is pressed.
     * 
     * @param window The GLFW window.
     * @param key The key that was pressed or released.
@@ -65,23 +87,13 @@ void mainloop();
  */
 int main(int argc, char **argv);
 
-#include <stdio.h>
-#include <stdlib.h>
-#include <iostream>
-#include <GL/glew.h>
-#include <GLFW/glfw3.h>
-#include <glm/glm.hpp>
-#include <glm/gtc/matrix_transform.hpp>
-#include "../component/particlesys.hpp"
-#include "../component/camera.hpp"
-#include "../component/background.hpp"
-#include "../component/shader.hpp"
-
 GLFWwindow *window;
 Camera *camera;
 Background *background;
 ParticleSystem *particleSystem;
 ParticleSystem *particleSystem2;
+FrameTimer *frameTimer;
+ShaderHotReload *shaderReload;
 
 void key_callback(GLFWwindow *window, int key, int scancode, int action, int mods)
 {
@@ -89,6 +101,14 @@ void key_callback(GLFWwindow *window, int key, int scancode, int action, int mod
     {
         glfwSetWindowShouldClose(window, GL_TRUE);
     }
+    if (key == GLFW_KEY_P && action == GLFW_PRESS)
+    {
+        particleSystem->printStatus();
+    }
+    if (key == GLFW_KEY_S && action == GLFW_PRESS)
+    {
+        particleSystem->setShaderFeatures(particleSystem->shaderFeatures ^ SHADER_SOFT);
+    }
 }
 
 void mouse_button_callback(GLFWwindow *window, int button, int action, int mods)
@@ -123,17 +143,35 @@ void mainloop()
 
     while (!glfwWindowShouldClose(window))
     {
+        PROFILE_SCOPE("frame");
+        frameTimer->beginFrame();
+
+        // Install shaders rebuilt since the last frame
+        if (shaderReload && shaderReload->poll())
+        {
+            background->programID = background->shader->program;
+            particleSystem->programID = particleSystem->shader->program;
+        }
+
+        // Upload textures decoded since the last frame, within a slice of the frame
+        AsyncTextureLoader::instance().pump(2.0);
+
         // Clear the color and depth buffer
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-        // Update camera position
-        camera->update(radius, theta, phi);
+        glm::mat4 MVP;
+        {
+            PROFILE_SCOPE("camera");
+
+            // Update camera position
+            camera->update(radius, theta, phi);
 
-        // Compute the MVP matrix
-        glm::mat4 Projection = glm::perspective(glm::radians(45.0f), 4.0f / 3.0f, 0.1f, 100.0f);
-        glm::mat4 View = camera->viewMatrix;
-        glm::mat4 Model = glm::mat4(1.0f);
-        glm::mat4 MVP = Projection * View * Model;
+            // Compute the MVP matrix
+            glm::mat4 Projection = glm::perspective(glm::radians(45.0f), 4.0f / 3.0f, 0.1f, 100.0f);
+            glm::mat4 View = camera->viewMatrix;
+            glm::mat4 Model = glm::mat4(1.0f);
+            MVP = Projection * View * Model;
+        }
 
         glBlendFunc(GL_SRC_ALPHA, GL_ONE);
         // glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA); 
@@ -143,30 +181,49 @@ void mainloop()
         // glBlendFunc(GL_SRC_ALPHA_SATURATE, GL_ONE_MINUS_SRC_ALPHA);
         // glBlendFunc(GL_SRC_ALPHA_SATURATE, GL_SRC_ALPHA);
 
-        // Pass MVP matrix to background's shader
-        GLuint backgroundMatrixID = glGetUniformLocation(background->programID, "MVP");
-        glUniformMatrix4fv(backgroundMatrixID, 1, GL_FALSE, &MVP[0][0]);
-        glEnable(GL_DEPTH_TEST);                           
-        glDepthFunc(GL_ALWAYS);                            
-        
+        {
+            PROFILE_SCOPE("background render");
+
+            // Pass MVP matrix to background's shader
+            GLuint backgroundMatrixID = glGetUniformLocation(background->programID, "MVP");
+            glUniformMatrix4fv(backgroundMatrixID, 1, GL_FALSE, &MVP[0][0]);
+            glEnable(GL_DEPTH_TEST);                           
+            glDepthFunc(GL_ALWAYS);                            
 
-        // render background
-        background->render();
+            // render background
+            background->render();
+        }
 
-        // Pass MVP matrix to particle system's shader
-        GLuint particleMatrixID = glGetUniformLocation(particleSystem->programID, "MVP");
-        // printf("Particle Matrix ID: %d\n", particleMatrixID);
-        glUniformMatrix4fv(particleMatrixID, 1, GL_FALSE, &MVP[0][0]);
+        {
+            PROFILE_SCOPE("particle render");
 
-        glEnable(GL_BLEND); 
-        // render particle system      
-        particleSystem->render(); 
-        glDisable(GL_BLEND);     
-        particleSystem->update(0.01f);
+            // Pass MVP matrix to particle system's shader
+            GLuint particleMatrixID = glGetUniformLocation(particleSystem->programID, "MVP");
+            // printf("Particle Matrix ID: %d\n", particleMatrixID);
+            glUniformMatrix4fv(particleMatrixID, 1, GL_FALSE, &MVP[0][0]);
+
+            glEnable(GL_BLEND); 
+            // render particle system      
+            particleSystem->render(); 
+            glDisable(GL_BLEND);     
+        }
+
+        {
+            PROFILE_SCOPE("update");
+            particleSystem->update(0.01f);
+        }
 
         // Swap buffers
-        glfwSwapBuffers(window);
-        glfwPollEvents();
+        frameTimer->endFrame();
+        {
+            PROFILE_SCOPE("swap");
+            glfwSwapBuffers(window);
+        }
+        frameTimer->presented();
+        {
+            PROFILE_SCOPE("poll events");
+            glfwPollEvents();
+        }
     }
 }
 
@@ -175,11 +232,118 @@ int main(int argc, char **argv)
     /*---Parse the passing arguments---*/
     if (argc < 2)
     {
-        fprintf(stderr, "Usage: %s <Number of particles>\n", argv[0]);
+        fprintf(stderr, "Usage: %s <Number of particles> [--frame-csv <file> [seconds]] [--hot-reload] [--loose-assets] [--dump-textures <dir>] [--quality low|medium|high] [--sprite radial|flame|smoke|<image>]... [--flipbook <frames>] [--instance-layout float|compact|half] [--forces <list>] [--ground bounce|kill|none] [--sdf <file.csdf>]... [--mode sprites|sph|nbody|boids]\n", argv[0]);
         return -1;
     }
     unsigned int numParticles = std::atoi(argv[1]);
 
+    const char *frameCsvPath = NULL;
+    double frameReportInterval = 5.0;
+    bool hotReload = false;
+    bool looseAssets = false;
+    EmitterConfig emitter;
+    std::vector<SpriteShape> spriteShapes;
+    int flipbookFrames = 0;
+    const char *ground = "bounce";
+    bool forcesGiven = false;
+    for (int i = 2; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--frame-csv") == 0 && i + 1 < argc)
+        {
+            frameCsvPath = argv[++i];
+            if (i + 1 < argc && argv[i + 1][0] != '-')
+                frameReportInterval = std::atof(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--hot-reload") == 0)
+        {
+            hotReload = true;
+        }
+        else if (strcmp(argv[i], "--loose-assets") == 0)
+        {
+            looseAssets = true;
+        }
+        else if (strcmp(argv[i], "--dump-textures") == 0 && i + 1 < argc)
+        {
+            setTextureDumpDirectory(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--quality") == 0 && i + 1 < argc)
+        {
+            i++;
+            emitter.quality = strcmp(argv[i], "low") == 0 ? QUALITY_LOW : strcmp(argv[i], "high") == 0 ? QUALITY_HIGH : QUALITY_MEDIUM;
+        }
+        else if (strcmp(argv[i], "--sprite") == 0 && i + 1 < argc)
+        {
+            i++;
+            if (strcmp(argv[i], "radial") == 0)
+                spriteShapes.push_back(SPRITE_RADIAL);
+            else if (strcmp(argv[i], "flame") == 0)
+                spriteShapes.push_back(SPRITE_FLAME);
+            else if (strcmp(argv[i], "smoke") == 0)
+                spriteShapes.push_back(SPRITE_SMOKE);
+            else
+                emitter.spritePath = argv[i];
+        }
+        else if (strcmp(argv[i], "--flipbook") == 0 && i + 1 < argc)
+        {
+            flipbookFrames = std::atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--instance-layout") == 0 && i + 1 < argc)
+        {
+            i++;
+            emitter.instanceLayout = strcmp(argv[i], "float") == 0  ? INSTANCE_FLOAT
+                                     : strcmp(argv[i], "half") == 0 ? INSTANCE_HALF
+                                                                    : INSTANCE_COMPACT;
+        }
+        else if (strcmp(argv[i], "--forces") == 0 && i + 1 < argc)
+        {
+            if (!parseForces(argv[++i], emitter.forces))
+                return -1;
+            forcesGiven = true;
+        }
+        else if (strcmp(argv[i], "--ground") == 0 && i + 1 < argc)
+        {
+            ground = argv[++i];
+        }
+        else if (strcmp(argv[i], "--mode") == 0 && i + 1 < argc)
+        {
+            i++;
+            emitter.mode = strcmp(argv[i], "sph") == 0     ? SIM_SPH
+                           : strcmp(argv[i], "nbody") == 0 ? SIM_NBODY
+                           : strcmp(argv[i], "boids") == 0 ? SIM_BOIDS
+                                                           : SIM_SPRITES;
+        }
+        else if (strcmp(argv[i], "--sdf") == 0 && i + 1 < argc)
+        {
+            std::shared_ptr<DistanceField> field = std::make_shared<DistanceField>();
+            if (!field->open(argv[++i]))
+                return -1;
+            emitter.colliders.push_back(Collider::distanceField(field));
+        }
+    }
+    if (!spriteShapes.empty())
+        emitter.sprite.shape = spriteShapes[0];
+    // Several sprites, or an animated one, go into one atlas so they still draw in one call.
+    // An image joins the atlas as a still sprite; an image alone is drawn as a plain texture.
+    if (spriteShapes.size() + (emitter.spritePath.empty() ? 0 : 1) > 1 || flipbookFrames > 0)
+    {
+        if (spriteShapes.empty() && emitter.spritePath.empty())
+            spriteShapes.push_back(emitter.sprite.shape);
+        for (SpriteShape shape : spriteShapes)
+        {
+            SpriteParams sprite = emitter.sprite;
+            sprite.shape = shape;
+            emitter.atlasSprites.push_back(sprite);
+        }
+        emitter.flipbookFrames = std::max(1, flipbookFrames);
+    }
+    PROFILE_THREAD_NAME("main");
+
+    // Shaders and the background texture are compiled in; the pack and loose files only add to or override them
+    setEmbeddedAssets(embeddedAssets, embeddedAssetCount);
+    // Hot reload watches the loose shader files, so they have to win over the built-in copies
+    setLooseAssetsFirst(looseAssets || hotReload);
+    AssetPack::instance().openOnFirstUse("assets.pak");
+
     if (!glfwInit())
     {
         fprintf(stderr, "Failed to initialize GLFW\n");
@@ -212,17 +376,49 @@ int main(int argc, char **argv)
 
     // Initialize background
     background = new Background();
+    // The floor doubles as a collider unless turned off
+    if (strcmp(ground, "none") != 0)
+    {
+        Collider floor = background->collider();
+        floor.response = strcmp(ground, "kill") == 0 ? COLLIDE_KILL : COLLIDE_BOUNCE;
+        if (emitter.mode == SIM_SPH)
+            floor.restitution = 0.0f;
+        emitter.colliders.push_back(floor);
+    }
+    // A fluid rests on the floor and runs off its edges into a kill plane below
+    if (emitter.mode == SIM_SPH)
+    {
+        emitter.sph.groundExtent = strcmp(ground, "none") == 0 ? -1.0f : background->scale;
+        Collider drain = Collider::plane(glm::vec3(0.0f, 0.0f, -5.0f), glm::vec3(0.0f, 0.0f, 1.0f));
+        drain.response = COLLIDE_KILL;
+        emitter.colliders.push_back(drain);
+    }
+
+    // Bodies and boids only feel each other unless forces were asked for
+    if ((emitter.mode == SIM_NBODY || emitter.mode == SIM_BOIDS) && !forcesGiven)
+        emitter.forces.clear();
 
-    particleSystem = new ParticleSystem(numParticles);
+    particleSystem = new ParticleSystem(numParticles, emitter);
 
     GLint maxUniformLength;
     glGetProgramiv(particleSystem->programID, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxUniformLength);
     std::cout << maxUniformLength << std::endl;
 
+    frameTimer = new FrameTimer(frameCsvPath, frameReportInterval);
+    shaderReload = hotReload ? new ShaderHotReload(window, "../shader") : NULL;
+
     mainloop();
-    glfwTerminate();
+    frameTimer->report(stdout);
+    delete frameTimer;
+    delete shaderReload;
+    // Release GL resources while the context still exists
     delete particleSystem;
     delete camera;
     delete background;
+    TextureManager::instance().clear();
+    GeometryRegistry::instance().clear();
+    AsyncTextureLoader::instance().shutdown();
+    PROFILE_WRITE_TRACE("particle_trace.json");
+    glfwTerminate();
     return 0;
 }
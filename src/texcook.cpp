@@ -0,0 +1,77 @@
+/**
+ * @file texcook.cpp
+ * @brief Offline texture cooker.
+ *
+ * Converts images into .ctex files with a precomputed mip chain, block
+ * compressed as BC1 (opaque) or BC3 (with alpha) unless told otherwise, so the
+ * viewer can upload them without decoding or generating mipmaps.
+ *
+ * Usage: texcook [--format auto|bc1|bc3|rgba8] <output directory> <images...>
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <filesystem>
+#include "../component/ctex.hpp"
+#include "../component/stb_image.h"
+
+int main(int argc, char **argv)
+{
+    const char *formatName = "auto";
+    int first = 1;
+    if (argc > 2 && strcmp(argv[1], "--format") == 0)
+    {
+        formatName = argv[2];
+        first = 3;
+    }
+    if (argc - first < 2)
+    {
+        fprintf(stderr, "Usage: %s [--format auto|bc1|bc3|rgba8] <output directory> <images...>\n", argv[0]);
+        return -1;
+    }
+    std::string outputDirectory = argv[first];
+    std::error_code error;
+    std::filesystem::create_directories(outputDirectory, error);
+
+    int failures = 0;
+    stbi_set_flip_vertically_on_load(true);
+    for (int i = first + 1; i < argc; i++)
+    {
+        CtexImage base;
+        int channels;
+        unsigned char *pixels = stbi_load(argv[i], &base.width, &base.height, &channels, 4);
+        if (!pixels)
+        {
+            fprintf(stderr, "Failed to load %s: %s\n", argv[i], stbi_failure_reason());
+            failures++;
+            continue;
+        }
+        base.pixels.assign(pixels, pixels + (size_t)base.width * base.height * 4);
+        stbi_image_free(pixels);
+
+        CtexFormat format;
+        if (strcmp(formatName, "bc1") == 0)
+            format = CTEX_BC1;
+        else if (strcmp(formatName, "bc3") == 0)
+            format = CTEX_BC3;
+        else if (strcmp(formatName, "rgba8") == 0)
+            format = CTEX_RGBA8;
+        else
+            format = ctexHasAlpha(base) ? CTEX_BC3 : CTEX_BC1;
+
+        std::vector<CtexImage> levels = ctexBuildMips(base);
+        std::string output = cookedTexturePath(outputDirectory, argv[i]);
+        std::filesystem::create_directories(std::filesystem::path(output).parent_path(), error);
+        if (!ctexWrite(output, format, levels))
+        {
+            failures++;
+            continue;
+        }
+        size_t bytes = std::filesystem::file_size(output, error);
+        printf("%s -> %s (%dx%d, %zu levels, %s, %zu bytes, %.1fx smaller than RGBA8 with mips)\n",
+               argv[i], output.c_str(), base.width, base.height, levels.size(),
+               format == CTEX_BC1 ? "BC1" : format == CTEX_BC3 ? "BC3" : "RGBA8", bytes,
+               (double)base.pixels.size() * 4 / 3 / bytes);
+    }
+    return failures ? 1 : 0;
+}